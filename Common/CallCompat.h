@@ -0,0 +1,39 @@
+#ifndef CALLCOMPAT_H
+#define CALLCOMPAT_H
+
+/**
+ * Accessors of the call instructions whose names changed between the LLVM releases supported by the passes
+ * (getNumArgOperands and getCalledValue are gone since LLVM 15 and 11, arg_size and getCalledOperand appeared in LLVM 8)
+ * @author INRIA Bordeaux STORM Project Team
+ **/
+
+#include "llvm/Config/llvm-config.h"
+#include "llvm/IR/Instructions.h"
+
+/**
+ * @function getNumCallArgs:
+ * @param CI a call instruction
+ * @returns the number of arguments given to the callee
+ **/
+inline unsigned getNumCallArgs(const llvm::CallInst* CI){
+#if LLVM_VERSION_MAJOR >= 8
+   return CI->arg_size();
+#else
+   return CI->getNumArgOperands();
+#endif
+}
+
+/**
+ * @function getCalledPointer:
+ * @param CI a call instruction
+ * @returns the value called: a function, a cast of a function or a function pointer
+ **/
+inline llvm::Value* getCalledPointer(const llvm::CallInst* CI){
+#if LLVM_VERSION_MAJOR >= 8
+   return CI->getCalledOperand();
+#else
+   return CI->getCalledValue();
+#endif
+}
+
+#endif
@@ -0,0 +1,159 @@
+#ifndef PHASETIMER_H
+#define PHASETIMER_H
+
+/**
+ * Timers shared by the passes: each phase of a pass is measured
+ *   - in the -time-passes report (one group per pass, one timer per phase, followed by the details per function)
+ *   - in the Chrome trace written by clang -ftime-trace (one event per phase and function)
+ * together with the net growth of the memory allocated with malloc during the phase (allocated at its end minus allocated at its start:
+ * what the phase frees before it ends, its peak included, is not seen).
+ * Nothing is measured, apart from the -ftime-trace events, when -time-passes is not given.
+ * @author INRIA Bordeaux STORM Project Team
+ **/
+
+#include "llvm/Config/llvm-config.h"
+#include "llvm/IR/Function.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+#if LLVM_VERSION_MAJOR >= 9
+#include "llvm/Support/TimeProfiler.h"
+#endif
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+
+class PhaseTimers{
+ public:
+   struct Record{
+      double seconds;
+      size_t netBytes;//the largest net growth of the memory allocated over the runs of the phase, not a high-water mark
+   };
+
+   explicit PhaseTimers(llvm::StringRef pass) : pass(pass) {}
+
+   /**
+    * @function report:
+    * displays the time and memory of each phase of each function, then the -time-passes group of the pass
+    **/
+   void report(){
+      if(functions.empty()){
+	 return;
+      }
+      llvm::errs() << "\033[0;36m======  " << pass << " PHASES PER FUNCTION  ======\033[0;0m\n";
+      for(auto &function : functions){
+	 for(auto &phase : function.second){
+	    llvm::errs() << llvm::format("%10.4fs %10zu bytes kept   ", phase.second.seconds, phase.second.netBytes)
+	       << function.first << " / " << phase.first << "\n";
+	 }
+      }
+      functions.clear();
+      timers.clear();//the group prints the timers once they are all stopped and deleted
+      group.reset();
+   }
+
+ private:
+   friend class PhaseScope;
+
+   std::string pass;
+   std::unique_ptr<llvm::TimerGroup> group;
+   std::map<std::string, std::unique_ptr<llvm::Timer>> timers;
+   std::map<std::string, unsigned> running;//loop_handler is recursive: only the outermost scope of a phase is timed
+   std::map<std::string, std::map<std::string, Record>> functions;
+
+   llvm::Timer& getTimer(const std::string &phase){
+      if(!group){
+#if LLVM_VERSION_MAJOR >= 4
+	 group.reset(new llvm::TimerGroup(pass, pass + " phases"));
+#else
+	 group.reset(new llvm::TimerGroup(pass + " phases"));
+#endif
+      }
+      std::unique_ptr<llvm::Timer> &timer = timers[phase];
+      if(!timer){
+#if LLVM_VERSION_MAJOR >= 4
+	 timer.reset(new llvm::Timer(phase, phase, *group));
+#else
+	 timer.reset(new llvm::Timer(phase, *group));
+#endif
+      }
+      return *timer;
+   }
+};
+
+class PhaseScope{
+ public:
+   /**
+    * @param timers the timers of the pass
+    * @param phase the name of the phase
+    * @param F the function being handled
+    **/
+   PhaseScope(PhaseTimers &timers, llvm::StringRef phase, llvm::Function &F){
+#if LLVM_VERSION_MAJOR >= 9
+      if(llvm::timeTraceProfilerEnabled()){
+	 trace.reset(new llvm::TimeTraceScope(phase, F.getName()));
+      }
+#endif
+      if(!llvm::TimePassesIsEnabled){
+	 return;
+      }
+      depth = &timers.running[phase.str()];
+      if((*depth)++ > 0){//already timed by an enclosing scope
+	 return;
+      }
+      owner = &timers;
+      name = phase.str();
+      function = F.getName().str();
+      owner->getTimer(name).startTimer();
+      start = llvm::TimeRecord::getCurrentTime(true);
+      memory = llvm::sys::Process::GetMallocUsage();
+   }
+
+   ~PhaseScope(){
+      stop();
+   }
+
+   /**
+    * @function stop:
+    * ends the phase before the end of the scope
+    **/
+   void stop(){
+#if LLVM_VERSION_MAJOR >= 9
+      trace.reset();
+#endif
+      if(depth == nullptr){
+	 return;
+      }
+      --*depth;
+      depth = nullptr;
+      if(owner == nullptr){
+	 return;
+      }
+      llvm::TimeRecord end = llvm::TimeRecord::getCurrentTime(false);
+      size_t used = llvm::sys::Process::GetMallocUsage();
+      PhaseTimers* timers = owner;
+      owner = nullptr;
+      timers->getTimer(name).stopTimer();
+      PhaseTimers::Record &record = timers->functions[function][name];
+      record.seconds += end.getWallTime() - start.getWallTime();
+      if(used > memory && used - memory > record.netBytes){
+	 record.netBytes = used - memory;
+      }
+   }
+
+ private:
+   unsigned* depth = nullptr;//null if -time-passes is not given
+   PhaseTimers* owner = nullptr;//null if this scope is not timed
+   std::string name;
+   std::string function;
+   llvm::TimeRecord start;
+   size_t memory = 0;
+#if LLVM_VERSION_MAJOR >= 9
+   std::unique_ptr<llvm::TimeTraceScope> trace;
+#endif
+};
+
+#endif
@@ -0,0 +1,533 @@
+#ifndef PLACEMENTPLAN_H
+#define PLACEMENTPLAN_H
+
+/**
+ * Placement plan of the STORE 0 of a function: the analysis of a pass decides all of them first (ScrubPlan), then a separate phase adds them to the code.
+ * The analysis never reads back what it decided from the code: the STORE 0 it already placed are kept in the plan, in a queue before the instruction of the program they precede,
+ * and the steps of the analysis which need to see them (a variable already at 0, the next instruction...) walk the code and the queues together (PlannedCode).
+ *
+ * The plan of PutAtZero can be written and read back (-paz-plan-export, -paz-plan-import),
+ * one JSON object per line, always the same keys in the same order, the functions in the order of the module:
+ *	{"module":"a.bc","function":"f","block":"3","position":5,"slot":1,"variable":"key","offset":0,"size":8,"pass":"PutAtZero","reason":"last use"}
+ * so that the plans of two versions can be compared with diff.
+ *	module:   the identifier of the module (the file it was read from, "<stdin>" for the standard input): paz-batch writes the plans of all its modules in the same file
+ *	block:    the index of the block in the function when the analysis ran, "from->to" for a STORE 0 on a split edge,
+ *	          "dead ends" for the block shared by the dead ends, "returns" for the block of the merged returns
+ *	position: the STORE 0 is put before this instruction of the block (0: the first one), the ones before the same instruction in the order of the lines;
+ *	          for the reasons "program memset" and "duplicate", the memset kept or the STORE 0 of the program removed
+ *	slot:     the index of the variable among the allocas of the entry block, -1 when it is not a local variable (coroutine frame...)
+ *	offset, size: the bytes set to 0, size 0 for the whole variable with a size known at runtime only (dynamic arrays)
+ * The entries with a slot of -1 cannot be replayed.
+ * @author INRIA Bordeaux STORM Project Team
+ **/
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/DataLayout.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+#if LLVM_VERSION_MAJOR >= 7
+#include "llvm/Support/JSON.h"
+#endif
+#include <algorithm>
+#include <map>
+#include <set>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "ScrubMetadata.h"
+
+static const char* const ProgramScrubReason = "program memset";//a memset of the program kept as a STORE 0: it is part of the program
+static const char* const DuplicateScrubReason = "duplicate";//a STORE 0 of the program removed: the variable is already at 0 (inlined function already handled)
+
+enum ScrubSite{
+   beforeInstruction,//before the instruction place of the program
+   onEdge,//on the edge from -> the block of place, split when it is critical (place: the first instruction a STORE 0 can precede in the successor)
+   inDeadEnds,//in the block shared by the dead ends (unreachable, resume)
+   beforeReturns,//before the return, once the returns are merged in a single block
+   programMemSet,//place is a memset to 0 of the program, kept (made volatile) in place of a STORE 0
+   removedStore//place is a store of the program which is removed: a duplicate STORE 0, or a value overwritten before being read
+};
+
+//an element of the code as the analysis sees it: an instruction of the program, or a STORE 0 of the plan
+struct PlannedCode{
+   llvm::Instruction* instruction;//nullptr for a STORE 0 of the plan
+   int scrub;//the index of the STORE 0 in the plan, -1 for an instruction
+
+   PlannedCode(llvm::Instruction* I = nullptr, int index = -1) : instruction(I), scrub(index) {}
+
+   bool isScrub() const{
+      return scrub >= 0;
+   }
+   bool isEnd() const{
+      return instruction == nullptr && scrub < 0;
+   }
+   bool operator==(const PlannedCode& other) const{
+      return instruction == other.instruction && scrub == other.scrub;
+   }
+   bool operator!=(const PlannedCode& other) const{
+      return !(*this == other);
+   }
+};
+
+struct ScrubPlacement{
+   ScrubSite site;
+   llvm::Instruction* place;
+   llvm::BasicBlock* from;//onEdge: the block the edge comes from
+   llvm::Value* address;//the variable (or the address) set to 0
+   llvm::Type* type;//a STORE 0 of the null value of this type, nullptr for a memset
+   uint64_t offset;//memset: the bytes [offset, offset + size) of address
+   uint64_t size;//memset: 0 for the whole dynamic array, its size is computed at runtime
+   PlannedCode trigger;//the use, exit or marker which made it necessary, for the debug location (none: the instruction it precedes once added)
+   llvm::Instruction* use;//the use displayed when the STORE 0 is added, nullptr
+   std::string pass;
+   std::string reason;
+   bool dropped;//taken back by a later step of the analysis (hoisted, moved between the lifetime markers, duplicate)
+
+   ScrubPlacement() : site(beforeInstruction), place(nullptr), from(nullptr), address(nullptr), type(nullptr), offset(0), size(0), use(nullptr), dropped(false) {}
+};
+
+class ScrubPlan{
+ public:
+   /**
+    * @function add:
+    * @param S the STORE 0
+    * @param front true to put it before the STORE 0 already planned at the same place, false after them
+    * @returns its index in the plan
+    **/
+   unsigned add(const ScrubPlacement& S, bool front = false){
+      unsigned index = placements.size();
+      placements.push_back(S);
+      placements.back().dropped = false;
+      if(S.site == removedStore){
+	 removed.insert(S.place);
+      }
+      if(isQueued(S)){
+	 std::vector<unsigned> &queue = queues[getKey(S)];
+	 queue.insert(front ? queue.begin() : queue.end(), index);
+      }
+      return index;
+   }
+
+   /**
+    * @function addBefore:
+    * @param next a STORE 0 of the plan
+    * @param S a STORE 0 at the same place, put right before next
+    * @returns its index in the plan
+    **/
+   unsigned addBefore(unsigned next, const ScrubPlacement& S){
+      unsigned index = placements.size();
+      placements.push_back(S);
+      placements.back().dropped = false;
+      std::vector<unsigned> &queue = queues[getKey(S)];
+      queue.insert(std::find(queue.begin(), queue.end(), next), index);
+      return index;
+   }
+
+   //the STORE 0 is not added (its index stays valid)
+   void drop(unsigned index){
+      ScrubPlacement &S = placements[index];
+      if(!S.dropped && isQueued(S)){
+	 std::vector<unsigned> &queue = queues[getKey(S)];
+	 queue.erase(std::remove(queue.begin(), queue.end(), index), queue.end());
+      }
+      if(!S.dropped && S.site == removedStore){
+	 removed.erase(S.place);
+      }
+      S.dropped = true;
+   }
+
+   void clear(){
+      placements.clear();
+      queues.clear();
+      removed.clear();
+      returnInstruction = nullptr;
+   }
+
+   //the return of a function with a single one: the STORE 0 before the returns follow the ones planned before it
+   void setReturn(const llvm::Instruction* RI){
+      returnInstruction = RI;
+   }
+
+   unsigned size() const{
+      return placements.size();
+   }
+
+   ScrubPlacement& operator[](unsigned index){
+      return placements[index];
+   }
+
+   const ScrubPlacement& operator[](unsigned index) const{
+      return placements[index];
+   }
+
+   //true if I is a store of the program which will be removed
+   bool isRemoved(const llvm::Instruction* I) const{
+      return removed.count(I) != 0;
+   }
+
+   //the STORE 0 put before the instruction I of the program, in the order of the code
+   const std::vector<unsigned>& getBefore(const llvm::Instruction* I) const{
+      return getQueue(Key(beforeInstruction, I, nullptr));
+   }
+
+   const std::vector<unsigned>& getOnEdge(const llvm::BasicBlock* from, const llvm::BasicBlock* to) const{
+      return getQueue(Key(onEdge, from, to));
+   }
+
+   const std::vector<unsigned>& getInDeadEnds() const{
+      return getQueue(Key(inDeadEnds, nullptr, nullptr));
+   }
+
+   const std::vector<unsigned>& getBeforeReturns() const{
+      return getQueue(Key(beforeReturns, nullptr, nullptr));
+   }
+
+   /**
+    * @function getCode:
+    * @param BB a block
+    * @returns its instructions with the STORE 0 planned before them, in the order of the code once the plan is applied (the stores removed are left out)
+    **/
+   std::vector<PlannedCode> getCode(llvm::BasicBlock* BB) const{
+      std::vector<PlannedCode> code;
+      for(llvm::Instruction &I : *BB){
+	 for(unsigned index : getBefore(&I)){
+	    code.push_back(PlannedCode(nullptr, index));
+	 }
+	 if(&I == returnInstruction){
+	    for(unsigned index : getBeforeReturns()){
+	       code.push_back(PlannedCode(nullptr, index));
+	    }
+	 }
+	 if(!isRemoved(&I)){
+	    code.push_back(PlannedCode(&I));
+	 }
+      }
+      return code;
+   }
+
+   /**
+    * @function getNext:
+    * @param code an instruction of the program or a STORE 0 planned before one
+    * @returns what follows it in the code once the plan is applied, the end of the block (isEnd) after the terminator
+    **/
+   PlannedCode getNext(PlannedCode code) const{
+      llvm::Instruction* next = nullptr;
+      if(code.isScrub()){
+	 const ScrubPlacement &S = placements[code.scrub];
+	 const std::vector<unsigned> &queue = getQueue(getKey(S));
+	 auto it = std::find(queue.begin(), queue.end(), (unsigned)code.scrub);
+	 if(it != queue.end() && it + 1 != queue.end()){
+	    return PlannedCode(nullptr, *(it + 1));
+	 }
+	 if(S.site == beforeInstruction && S.place == returnInstruction && !getBeforeReturns().empty()){
+	    return PlannedCode(nullptr, getBeforeReturns().front());
+	 }
+	 if(S.site == beforeReturns && returnInstruction != nullptr){
+	    return PlannedCode(const_cast<llvm::Instruction*>(returnInstruction));
+	 }
+	 if(S.site != beforeInstruction){//the end of a block of the pass
+	    return PlannedCode();
+	 }
+	 next = S.place;
+	 if(!isRemoved(next)){
+	    return PlannedCode(next);
+	 }
+	 next = next->getNextNode();
+      }
+      else{
+	 next = code.instruction->getNextNode();
+      }
+      for(; next != nullptr; next = next->getNextNode()){
+	 if(!getBefore(next).empty()){
+	    return PlannedCode(nullptr, getBefore(next).front());
+	 }
+	 if(next == returnInstruction && !getBeforeReturns().empty()){
+	    return PlannedCode(nullptr, getBeforeReturns().front());
+	 }
+	 if(!isRemoved(next)){
+	    return PlannedCode(next);
+	 }
+      }
+      return PlannedCode();
+   }
+
+   /**
+    * @function getInsertionPoint:
+    * the STORE 0 are added in the order of the plan: a STORE 0 goes before the first STORE 0 which follows it in its queue and is already added
+    * @param index a STORE 0 of the plan
+    * @param added the instructions of the STORE 0 already added, nullptr for the others
+    * @param end the instruction which follows the queue (place, or the terminator of a block of the pass)
+    * @returns the instruction before which the STORE 0 is added
+    **/
+   llvm::Instruction* getInsertionPoint(unsigned index, const std::vector<llvm::Instruction*>& added, llvm::Instruction* end) const{
+      const std::vector<unsigned> &queue = getQueue(getKey(placements[index]));
+      for(auto it = std::find(queue.begin(), queue.end(), index); it != queue.end(); ++it){
+	 if(*it != index && added[*it] != nullptr){
+	    return added[*it];
+	 }
+      }
+      return end;
+   }
+
+   /**
+    * @function getOrder:
+    * @param F the function of the plan
+    * @returns the STORE 0 which are not dropped, in the order of the code: the blocks of F with their edges, then the dead ends and the returns
+    **/
+   std::vector<unsigned> getOrder(llvm::Function& F) const{
+      std::map<const llvm::Instruction*, std::vector<unsigned>> program;//the memsets kept and the stores removed
+      for(unsigned index = 0; index < placements.size(); ++index){
+	 if(!placements[index].dropped && !isQueued(placements[index])){
+	    program[placements[index].place].push_back(index);
+	 }
+      }
+      std::vector<unsigned> order;
+      for(llvm::BasicBlock &BB : F){
+	 for(llvm::Instruction &I : BB){
+	    const std::vector<unsigned> &before = getBefore(&I);
+	    order.insert(order.end(), before.begin(), before.end());
+	    auto found = program.find(&I);
+	    if(found != program.end()){
+	       order.insert(order.end(), found->second.begin(), found->second.end());
+	    }
+	 }
+	 std::vector<llvm::BasicBlock*> successors;
+	 for(llvm::BasicBlock* to : llvm::successors(&BB)){
+	    if(std::find(successors.begin(), successors.end(), to) == successors.end()){
+	       successors.push_back(to);
+	       const std::vector<unsigned> &edge = getOnEdge(&BB, to);
+	       order.insert(order.end(), edge.begin(), edge.end());
+	    }
+	 }
+      }
+      order.insert(order.end(), getInDeadEnds().begin(), getInDeadEnds().end());
+      order.insert(order.end(), getBeforeReturns().begin(), getBeforeReturns().end());
+      return order;
+   }
+
+ private:
+   typedef std::tuple<ScrubSite, const llvm::Value*, const llvm::Value*> Key;
+
+   std::vector<ScrubPlacement> placements;//in the order the analysis decided them
+   std::map<Key, std::vector<unsigned>> queues;//the STORE 0 at the same place, in the order of the code
+   std::set<const llvm::Instruction*> removed;//the stores of the program removed
+   const llvm::Instruction* returnInstruction = nullptr;
+
+   static bool isQueued(const ScrubPlacement& S){
+      return S.site != programMemSet && S.site != removedStore;
+   }
+
+   static Key getKey(const ScrubPlacement& S){
+      switch(S.site){
+	 case beforeInstruction:
+	    return Key(beforeInstruction, S.place, nullptr);
+	 case onEdge:
+	    return Key(onEdge, S.from, S.place->getParent());
+	 default:
+	    return Key(S.site, nullptr, nullptr);
+      }
+   }
+
+   const std::vector<unsigned>& getQueue(const Key& key) const{
+      static const std::vector<unsigned> none;
+      auto found = queues.find(key);
+      return found != queues.end() ? found->second : none;
+   }
+};
+
+struct PlannedScrub{
+   std::string module;
+   std::string function;
+   std::string block;
+   unsigned position;
+   int slot;
+   std::string variable;
+   uint64_t offset;
+   uint64_t size;
+   std::string pass;
+   std::string reason;
+
+   PlannedScrub() : position(0), slot(-1), offset(0), size(0) {}
+
+   bool isReplayable() const{
+      return !block.empty() && slot >= 0;
+   }
+};
+
+/**
+ * @function getPlannedScrubs:
+ * writes the plan of a function with the indexes of its blocks, instructions and variables
+ * @param F the function, as it was when the analysis ran (no STORE 0 added yet)
+ * @param name the name written in the plan (F may be a copy of the function)
+ * @param plan the plan of F
+ * @returns the STORE 0 in the order of the code
+ **/
+inline std::vector<PlannedScrub> getPlannedScrubs(llvm::Function& F, llvm::StringRef name, const ScrubPlan& plan){
+   std::map<const llvm::BasicBlock*, unsigned> blocks;
+   std::map<const llvm::Instruction*, unsigned> positions;
+   unsigned block = 0;
+   for(llvm::BasicBlock &BB : F){
+      unsigned position = 0;
+      for(llvm::Instruction &I : BB){
+	 positions[&I] = position++;
+      }
+      blocks[&BB] = block++;
+   }
+   std::vector<llvm::Value*> slots;
+   for(llvm::Instruction &I : F.getEntryBlock()){
+      if(llvm::isa<llvm::AllocaInst>(&I)){
+	 slots.push_back(&I);
+      }
+   }
+   const llvm::DataLayout &DL = F.getParent()->getDataLayout();
+   std::vector<PlannedScrub> planned;
+   for(unsigned index : plan.getOrder(F)){
+      const ScrubPlacement &S = plan[index];
+      PlannedScrub scrub;
+      scrub.module = F.getParent()->getModuleIdentifier();
+      scrub.function = name.str();
+      switch(S.site){
+	 case onEdge:
+	    scrub.block = std::to_string(blocks[S.from]) + "->" + std::to_string(blocks[S.place->getParent()]);
+	    break;
+	 case inDeadEnds:
+	    scrub.block = "dead ends";
+	    break;
+	 case beforeReturns:
+	    scrub.block = "returns";
+	    break;
+	 default:
+	    scrub.block = std::to_string(blocks[S.place->getParent()]);
+	    scrub.position = positions[S.place];
+      }
+      auto slot = std::find(slots.begin(), slots.end(), S.address);
+      scrub.slot = slot != slots.end() ? (int)(slot - slots.begin()) : -1;
+      scrub.variable = getScrubbedName(S.address).str();
+      if(S.site == programMemSet){
+	 llvm::ConstantInt* length = llvm::dyn_cast<llvm::ConstantInt>(llvm::cast<llvm::MemSetInst>(S.place)->getLength());
+	 scrub.size = length != nullptr ? length->getZExtValue() : 0;
+      }
+      else if(S.site == removedStore){
+	 scrub.size = DL.getTypeStoreSize(llvm::cast<llvm::StoreInst>(S.place)->getValueOperand()->getType());
+      }
+      else if(S.type != nullptr){
+	 scrub.size = DL.getTypeStoreSize(S.type);
+      }
+      else{
+	 scrub.offset = S.offset;
+	 scrub.size = S.size;
+      }
+      scrub.pass = S.pass;
+      scrub.reason = S.reason;
+      planned.push_back(scrub);
+   }
+   return planned;
+}
+
+/**
+ * @function writePlanString:
+ * writes a string of the plan with the escapes of JSON
+ **/
+inline void writePlanString(llvm::raw_ostream& out, llvm::StringRef text){
+   out << '"';
+   for(char c : text){
+      if(c == '"' || c == '\\'){
+	 out << '\\' << c;
+      }
+      else if((unsigned char)c < 0x20){
+	 out << llvm::format("\\u%04x", (unsigned char)c);
+      }
+      else{
+	 out << c;
+      }
+   }
+   out << '"';
+}
+
+/**
+ * @function writePlan:
+ * writes the plan, one STORE 0 per line
+ * @param out the stream
+ * @param plan the plan
+ * @returns nothing
+ **/
+inline void writePlan(llvm::raw_ostream& out, const std::vector<PlannedScrub>& plan){
+   for(const PlannedScrub &scrub : plan){
+      out << "{\"module\":";
+      writePlanString(out, scrub.module);
+      out << ",\"function\":";
+      writePlanString(out, scrub.function);
+      out << ",\"block\":";
+      writePlanString(out, scrub.block);
+      out << ",\"position\":" << scrub.position << ",\"slot\":" << scrub.slot << ",\"variable\":";
+      writePlanString(out, scrub.variable);
+      out << ",\"offset\":" << scrub.offset << ",\"size\":" << scrub.size << ",\"pass\":";
+      writePlanString(out, scrub.pass);
+      out << ",\"reason\":";
+      writePlanString(out, scrub.reason);
+      out << "}\n";
+   }
+}
+
+#if LLVM_VERSION_MAJOR >= 7
+/**
+ * @function readPlan:
+ * reads a plan written by writePlan (llvm::json, LLVM 7 and later)
+ * @param text the content of the file
+ * @param plan the STORE 0 read are added to it
+ * @param error set to the first line which cannot be read
+ * @returns false if a line cannot be read
+ **/
+inline bool readPlan(llvm::StringRef text, std::vector<PlannedScrub>& plan, std::string& error){
+   llvm::SmallVector<llvm::StringRef, 64> lines;
+   text.split(lines, '\n', -1, false);
+   for(llvm::StringRef line : lines){
+      line = line.trim();
+      if(line.empty()){
+	 continue;
+      }
+      llvm::Expected<llvm::json::Value> value = llvm::json::parse(line);
+      if(!value){
+	 error = llvm::toString(value.takeError()) + ": " + line.str();
+	 return false;
+      }
+      llvm::json::Object* O = value->getAsObject();
+      if(O == nullptr || !O->getString("function") || !O->getString("block") || !O->getInteger("position") || !O->getInteger("slot")){
+	 error = "not a STORE 0 of a plan: " + line.str();
+	 return false;
+      }
+      PlannedScrub scrub;
+      if(auto module = O->getString("module")){
+	 scrub.module = module->str();
+      }
+      scrub.function = O->getString("function")->str();
+      scrub.block = O->getString("block")->str();
+      scrub.position = *O->getInteger("position");
+      scrub.slot = *O->getInteger("slot");
+      if(auto variable = O->getString("variable")){
+	 scrub.variable = variable->str();
+      }
+      if(auto offset = O->getInteger("offset")){
+	 scrub.offset = *offset;
+      }
+      if(auto size = O->getInteger("size")){
+	 scrub.size = *size;
+      }
+      if(auto pass = O->getString("pass")){
+	 scrub.pass = pass->str();
+      }
+      if(auto reason = O->getString("reason")){
+	 scrub.reason = reason->str();
+      }
+      plan.push_back(scrub);
+   }
+   return true;
+}
+#endif
+
+#endif
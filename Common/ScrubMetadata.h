@@ -0,0 +1,112 @@
+#ifndef SCRUBMETADATA_H
+#define SCRUBMETADATA_H
+
+/**
+ * Tag shared by the passes: every STORE 0 they add carries
+ *   - the debug location of the instruction which made it necessary (the last use, the exit...),
+ *     so that perf annotate and the sampling profilers charge its cost to the right line
+ *   - the metadata !storm.scrub !{!"variable", !"pass"[, !"reason"]}, so that the profilers and the later passes can tell it from the code of the program
+ *     (the reason is the step of the placement which added it: last use, exit, loop exit..., see PlacementPlan.h)
+ * @author INRIA Bordeaux STORM Project Team
+ **/
+
+#include "llvm/IR/DebugInfoMetadata.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Metadata.h"
+#include <vector>
+
+static const char* const ScrubMetadataName = "storm.scrub";
+
+/**
+ * @function getScrubbedName:
+ * @param V the address set to 0
+ * @returns the name of the variable in the source code (llvm.dbg.declare), the name of the value, or "?"
+ **/
+inline llvm::StringRef getScrubbedName(llvm::Value* V){
+   V = V->stripInBoundsOffsets();
+   if(V->isUsedByMetadata()){
+      if(llvm::LocalAsMetadata* L = llvm::LocalAsMetadata::getIfExists(V)){
+	 if(llvm::MetadataAsValue* MDV = llvm::MetadataAsValue::getIfExists(V->getContext(), L)){
+	    for(llvm::User* U : MDV->users()){
+	       if(llvm::DbgDeclareInst* DDI = llvm::dyn_cast<llvm::DbgDeclareInst>(U)){
+		  return DDI->getVariable()->getName();
+	       }
+	    }
+	 }
+      }
+   }
+   return V->hasName() ? V->getName() : "?";
+}
+
+/**
+ * @function getNearestDebugLoc:
+ * @param I an instruction
+ * @returns the debug location of I, or else of the closest instruction of its block which has one (the next ones first)
+ **/
+inline llvm::DebugLoc getNearestDebugLoc(llvm::Instruction* I){
+   for(llvm::Instruction* next = I; next != nullptr; next = next->getNextNode()){
+      if(next->getDebugLoc()){
+	 return next->getDebugLoc();
+      }
+   }
+   for(llvm::Instruction* previous = I->getPrevNode(); previous != nullptr; previous = previous->getPrevNode()){
+      if(previous->getDebugLoc()){
+	 return previous->getDebugLoc();
+      }
+   }
+   return llvm::DebugLoc();
+}
+
+/**
+ * @function tagScrub:
+ * gives a STORE 0 the debug location of the instruction which triggered it and the !storm.scrub metadata
+ * @param S the STORE 0 (a volatile store or memset)
+ * @param address the address it sets to 0
+ * @param pass the name of the pass which added it
+ * @param trigger the use, exit or marker which made it necessary (nullptr: the location of S is kept)
+ * @param reason why it was added, left out of the metadata when empty
+ * @returns nothing
+ **/
+inline void tagScrub(llvm::Instruction* S, llvm::Value* address, llvm::StringRef pass, llvm::Instruction* trigger, llvm::StringRef reason = llvm::StringRef()){
+   if(trigger != nullptr && trigger->getFunction() == S->getFunction()){//a location of another function would break the debug information
+      llvm::DebugLoc loc = getNearestDebugLoc(trigger);
+      if(loc){
+	 S->setDebugLoc(loc);
+      }
+   }
+   if(!S->getDebugLoc()){
+      S->setDebugLoc(getNearestDebugLoc(S));
+   }
+   llvm::LLVMContext &Ctx = S->getContext();
+   std::vector<llvm::Metadata*> operands = {llvm::MDString::get(Ctx, getScrubbedName(address)), llvm::MDString::get(Ctx, pass)};
+   if(!reason.empty()){
+      operands.push_back(llvm::MDString::get(Ctx, reason));
+   }
+   S->setMetadata(ScrubMetadataName, llvm::MDNode::get(Ctx, operands));
+}
+
+/**
+ * @function isTaggedScrub:
+ * @returns true if the instruction is a STORE 0 added by one of the passes
+ **/
+inline bool isTaggedScrub(const llvm::Instruction* I){
+   return I->getMetadata(ScrubMetadataName) != nullptr;
+}
+
+/**
+ * @function getScrubTag:
+ * @param I a STORE 0 added by one of the passes
+ * @param operand 0: the variable, 1: the pass, 2: the reason
+ * @returns the operand of its !storm.scrub metadata, "" if there is none
+ **/
+inline llvm::StringRef getScrubTag(const llvm::Instruction* I, unsigned operand){
+   llvm::MDNode* N = I->getMetadata(ScrubMetadataName);
+   if(N == nullptr || operand >= N->getNumOperands()){
+      return "";
+   }
+   llvm::MDString* text = llvm::dyn_cast<llvm::MDString>(N->getOperand(operand));
+   return text != nullptr ? text->getString() : "";
+}
+
+#endif
@@ -32,6 +32,9 @@
 #include "llvm/Analysis/LoopInfo.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Analysis/PostDominators.h"
+#include "PhaseTimer.h"
+#include "PlacementPlan.h"
+#include "ScrubMetadata.h"
 #include <utility>
 
 using namespace llvm;
@@ -42,7 +45,10 @@ namespace {
    static char ID;
    static int numSTORE0ADDED;//The number of instruction STORE 0 added
 
-   DeadVariableHandler() : FunctionPass(ID) {}
+   PhaseTimers timers;//-time-passes, -ftime-trace
+   ScrubPlan plan;//the STORE 0 of the current function, decided before any is added
+
+   DeadVariableHandler() : FunctionPass(ID), timers("DeadVariableHandler") {}
 
    bool runOnFunction(Function &F) override {
 
@@ -53,6 +59,7 @@ namespace {
 
       **/
 
+      plan.clear();
       SmallVector <Instruction*,16> storage;
       SmallVector <BasicBlock*, 8> blocksInLoop;
       SmallVector <Instruction*, 8> references;
@@ -60,6 +67,7 @@ namespace {
 
       LoopInfo& loopData = getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
       
+      PhaseScope collect(timers, "collect", F);
       for(BasicBlock &BB : F){
 	 if(loopData.isLoopHeader(&BB)){
 	    blocksInLoop.push_back(&BB);
@@ -82,16 +90,16 @@ namespace {
    	 BasicBlock* BB = dyn_cast<BasicBlock>(itBlock);
    	 I = BB->getTerminator();
    	 while(I != nullptr){
-   	    if(I->getOpcode() == 30 || I->getOpcode() == 31){
+   	    if(I->getOpcode() == Instruction::Load || I->getOpcode() == Instruction::Store){
       	       if(AllocaInst *AI = dyn_cast<AllocaInst>(I->getOperand(I->getNumOperands() - 1))){
-		  if(I->getOpcode() == 31 && I->getOperand(0)->getType()->getTypeID() == Type::PointerTyID){
+		  if(I->getOpcode() == Instruction::Store && I->getOperand(0)->getType()->getTypeID() == Type::PointerTyID){
 		     references.push_back(I);
 		  }
    		  storage.push_back(I);
    		  storageSize++;
 	       }
    	    }
-	    if(I->getOpcode() == 32){
+	    if(I->getOpcode() == Instruction::GetElementPtr){
 	       arrayHandler.push_back(I);
 	    }
    	    I = I->getPrevNode();	 //'new' I is now the instruction right before 'old' I.
@@ -103,6 +111,9 @@ namespace {
 	    itBlock--;//goes to the previous block
 	 }
       }
+      collect.stop();
+
+      PhaseScope dead(timers, "dead variables", F);
       int cpt = 0;
       Instruction* currentInst = nullptr;
       if(storageSize > 0){
@@ -126,16 +137,16 @@ namespace {
 	    if(storage[cpt_bis]->getOperand(storage[cpt_bis]->getNumOperands() - 1) == currentInst->getOperand(currentInst->getNumOperands() - 1)){
 	       //if the register is the same
 	       isEverUsedAfter = true;//the variable is reused
-	       if(storage[cpt_bis]->getOpcode() == 31 && storage[cpt_bis]->getParent() == currentInst->getParent() && !isAStore0Inst(*currentInst)){
+	       if(storage[cpt_bis]->getOpcode() == Instruction::Store && storage[cpt_bis]->getParent() == currentInst->getParent() && !isAStore0Inst(*currentInst)){
 		  //if the value is overwritten, we can put it to 0 just after the first write
 		  //technically, dse asserts that we cannot enter into this state
-		  addStore0(*currentInst);
+		  planStore0(*currentInst);
 		  break;
 	       }
-	       if(storage[cpt_bis]->getOpcode() == 31 && !loadedInHeader){
+	       if(storage[cpt_bis]->getOpcode() == Instruction::Store && !loadedInHeader){
 		  isEverUsedAfter = false;//if the value is rewritten in another block then we can suppose that it will never be used
 	       }
-	       if(storage[cpt_bis]->getOpcode() == 30){//if the value is loaded
+	       if(storage[cpt_bis]->getOpcode() == Instruction::Load){//if the value is loaded
 		  SmallVector<BasicBlock*, 8> futureStack;
 		  if(isInSuccessor(*currentInst->getParent(), *storage[cpt_bis]->getParent(), futureStack)){//in a block accessible from the current one
 		     break;//we shall not pass !
@@ -146,10 +157,10 @@ namespace {
 	    cpt_bis++;
 	 }
 	 if(!isEverUsedAfter && !isAtZeroInTheBlock(*currentInst->getParent(), currentInst->getOperand(currentInst->getNumOperands() - 1))){//if the variable is not used anymore and is not already at 0
-	    addStore0(*currentInst);
+	    planStore0(*currentInst);
 	 }
 	 if(!locked && !isAtZeroInTheBlock(F.back(), currentInst->getOperand(currentInst->getNumOperands() - 1))){//whatever the case is, we put the value at 0 at the end of the program to make sure that it is really erased once and for all
-   	    addStore0(*currentInst, currentInst->getOperand(currentInst->getNumOperands() - 1), F.back().getTerminator());
+   	    planStore0(*currentInst, currentInst->getOperand(currentInst->getNumOperands() - 1), F.back().getTerminator());
 	 }
 	 ++cpt;
 	 if(cpt < storageSize){
@@ -162,6 +173,13 @@ namespace {
 	    currentInst = nullptr;
 	 }
       }
+      dead.stop();
+
+      PhaseScope apply(timers, "addStore0", F);
+      std::vector<Instruction*> added(plan.size(), nullptr);
+      for(unsigned i = 0; i < plan.size(); ++i){
+	 added[i] = addStore0(plan[i], plan.getInsertionPoint(i, added, plan[i].place));
+      }
       return true;
    }
 
@@ -182,7 +200,7 @@ namespace {
 	       isAtZero = true;
 	       Instruction* INP = dyn_cast<Instruction>(references[cpt-1]->getOperand(0));
 	       if(INP != nullptr){
-		  addStore0(*INP, references[cpt-1]->getOperand(0), &Iplace);
+		  planStore0(*INP, references[cpt-1]->getOperand(0), &Iplace);
 	       }
 	    }
 	    references.erase(references.begin() + (cpt-1));
@@ -198,7 +216,7 @@ namespace {
     * @returns true if the instruction was a Store 0, false elsewhere
     **/
    bool isAStore0Inst(Instruction &I){
-      if(I.getOpcode() == 31){
+      if(I.getOpcode() == Instruction::Store){
     	 if(Constant *C = dyn_cast<Constant>(I.getOperand(0))){
   	    if(C->isNullValue()){
   	       return true;
@@ -229,21 +247,27 @@ namespace {
    /**
     * @function isAtZeroInTheBlock:
     * checks if the Value V is put at 0 at the end of the block, if there is any other instruction touching to V, it supposes that it does not store a 0
-    * @param BB the BasicBlock where our test is run
+    * @param BB the BasicBlock where our test is run, with the STORE 0 planned in it
     * @param V the Value supposed to be put at 0
     * @precond V is matching a register, if this precond is false, the function will always return false
     * @returns true if the last instruction on V in BB is a Store 0 => if V is put at 0 at the end of the block
     **/
    bool isAtZeroInTheBlock(BasicBlock &BB, Value* V){
-      Instruction* I = BB.getTerminator();
-      while(I != nullptr){
+      std::vector<PlannedCode> code = plan.getCode(&BB);//with the STORE 0 already planned in BB
+      for(auto it = code.rbegin(); it != code.rend(); ++it){
+	 if(it->isScrub()){
+	    if(plan[it->scrub].address == V){
+	       return true;
+	    }
+	    continue;
+	 }
+	 Instruction* I = it->instruction;
   	 if(I->getNumOperands() != 0 && I->getOperand(I->getNumOperands() - 1) == V){
   	    if(isAStore0Inst(*I)){
   	       return true;
   	    }
   	    return false;
     	 }
-     	 I = I->getPrevNode();
       }
       return false;
    }
@@ -262,7 +286,7 @@ namespace {
       while(BB != nullptr){
 	 if(isInSmallBasicBlockVect(HeaderBBlocks, *BB)){
 	    for(Instruction &I : *BB){
-	       if((I.getOpcode() == 30 || I.getOpcode() == 31) && I.getOperand(0) == Ins->getOperand(Ins->getNumOperands() - 1)){
+	       if((I.getOpcode() == Instruction::Load || I.getOpcode() == Instruction::Store) && I.getOperand(0) == Ins->getOperand(Ins->getNumOperands() - 1)){
 		  return true;
 	       }
 	    }
@@ -301,16 +325,15 @@ namespace {
    }
 
 
-   /**@function addStore0
-    * adds a store 0 of the Value V, before the instruction Iplace.
-    * in debug mode, it tries to display where in the source code it decided to add this store 0 instruction.
+   /**@function planStore0
+    * plans a store 0 of the Value V, before the instruction Iplace.
     * @param I, the instruction with all the data we need
     * @param V, the Value containing the type of store 0 we want (default, the value accessed by I)
     * @param Iplace, the instruction before which we want to add a store 0 instruction (default, before the instruction following I)
     * @returns nothing but
-    * @postcond a Store 0 instruction was added before Iplace or right after I
+    * @postcond a Store 0 instruction is planned before Iplace (after the ones already planned there) or right after I (before them)
     **/
-   void addStore0(Instruction &I, Value* V = nullptr, Instruction *Iplace = nullptr){
+   void planStore0(Instruction &I, Value* V = nullptr, Instruction *Iplace = nullptr){
       Instruction *NextI = Iplace;
       if(NextI == nullptr){
 	 NextI = I.getNextNode();
@@ -321,24 +344,49 @@ namespace {
       if(NextI == nullptr){
 	 return;
       }
+      ScrubPlacement S;
+      S.place = NextI;
+      S.address = V;
+      S.type = I.getOpcode() == Instruction::Load ? I.getType() : I.getOperand(0)->getType();
+      S.trigger = PlannedCode(&I);
+      S.use = &I;
+      S.pass = "DeadVariableHandler";
+      switch (S.type->getTypeID()) {
+	 case Type::IntegerTyID:
+	 case Type::FloatTyID:
+	 case Type::DoubleTyID:
+	 case Type::HalfTyID:
+	 case Type::FP128TyID:
+	 case Type::X86_FP80TyID:
+	 case Type::PPC_FP128TyID:
+	 case Type::X86_MMXTyID:
+	 case Type::PointerTyID:
+	 case Type::ArrayTyID:
+	    plan.add(S, Iplace == nullptr);
+	    break;
+
+	 default:
+	    errs() << "can't do my stuff\n";
+	    numSTORE0ADDED++;
+      }
+   }
+
+   /**@function addStore0
+    * adds a store 0 of the plan.
+    * in debug mode, it tries to display where in the source code it decided to add this store 0 instruction.
+    * @param S, the store 0, planned by planStore0
+    * @param NextI, the instruction before which it is added
+    * @returns the store 0
+    **/
+   Instruction* addStore0(const ScrubPlacement& S, Instruction *NextI){
+      Instruction &I = *S.use;
+      Value* V = S.address;
       IRBuilder<> Builder(NextI);
       StoreInst* Store0 =  nullptr;
-      int ID = 0;
-      if(I.getOpcode() == 30){
-	 ID = I.getType()->getTypeID();
-      }
-      else{
-	 ID = I.getOperand(0)->getType()->getTypeID();
-      }
-      switch (ID) {//each case allows to check the type and store 0 type get<Typename>Ty at @operand with volatile=true in order to survive other pass
+      switch (S.type->getTypeID()) {//each case allows to check the type and store 0 type get<Typename>Ty at @operand with volatile=true in order to survive other pass
 
 	 case Type::IntegerTyID:
-	    if(I.getOpcode() == 30){
-   	       Store0 = Builder.CreateStore(ConstantInt::get(Builder.getIntNTy(cast<IntegerType>(I.getType())->getBitWidth()), 0), V, true);
-	    }
-	    else{
-	       Store0 = Builder.CreateStore(ConstantInt::get(Builder.getIntNTy(cast<IntegerType>(I.getOperand(0)->getType())->getBitWidth()), 0), V, true);
-	    }
+	    Store0 = Builder.CreateStore(ConstantInt::get(Builder.getIntNTy(cast<IntegerType>(S.type)->getBitWidth()), 0), V, true);
 	    break;
 		 
 	 case Type::FloatTyID:
@@ -370,35 +418,21 @@ namespace {
 	    break;
 
 	 case Type::PointerTyID:
-	    if(I.getOpcode() == 30){
-   	       Store0 = Builder.CreateStore(Constant::getNullValue(cast<PointerType>(I.getType())), V, true);
-	    }
-	    else{
-	       Store0 = Builder.CreateStore(Constant::getNullValue(cast<PointerType>(I.getOperand(0)->getType())), V, true);
-	    }
-	    break;
-
-	 case Type::VectorTyID:
-	    //VectorType* vect = dyn_cast<VectorType>(I.getType());
-	    //Store0 = Builder.CreateStore(Constant::getNullValue(vect), V, true);
+   	    Store0 = Builder.CreateStore(Constant::getNullValue(cast<PointerType>(S.type)), V, true);
 	    break;
 
 	 case Type::ArrayTyID:
-	    ArrayType* array = dyn_cast<ArrayType>(I.getType());
-	    Store0 = Builder.CreateStore(Constant::getNullValue(array), V, true);
+	    Store0 = Builder.CreateStore(Constant::getNullValue(S.type), V, true);
 	    break;
       }
-      if(Store0 == nullptr){
-	 errs() << "can't do my stuff\n";
-      }
-      else{
-	 if(I.getDebugLoc()){
-	    errs() << "adding STORE 0 (after)\t\t\t";
-	    I.getDebugLoc().print(errs());
-	    errs() << "\n";
-	 }
+      tagScrub(Store0, V, "DeadVariableHandler", &I);
+      if(I.getDebugLoc()){
+	 errs() << "adding STORE 0 (after)\t\t\t";
+	 I.getDebugLoc().print(errs());
+	 errs() << "\n";
       }
       numSTORE0ADDED++;
+      return Store0;
    }
 
    /**
@@ -408,6 +442,7 @@ namespace {
     * @returns false because the code wasn't modified during its execution
     **/
    bool doFinalization(Module &M) override{
+      timers.report();
       errs() << "\n(Information are displayed in file:line:column mode)\n\n";
       errs() << "\033[0;36m======================================\033[0;0m\n";
       errs() << "\033[0;36m=======   TRACKER STATISTICS   =======\033[0;0m\n";
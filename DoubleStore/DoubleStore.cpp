@@ -28,6 +28,8 @@
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Analysis/LoopInfo.h"
+#include "PhaseTimer.h"
+#include "ScrubMetadata.h"
 
 //TODO faire un parcours de l'arbre à l'envers en stockant les load et les store uniquement
 using namespace llvm;
@@ -39,7 +41,9 @@ namespace {
    static int numSTORE0ADDED;//The number of instruction STORE 0 added
    static int numSTOREDELETED;//The number of useless STORE removed
 
-   DoubleStoreInstr() : FunctionPass(ID) {}
+   PhaseTimers timers;//-time-passes, -ftime-trace
+
+   DoubleStoreInstr() : FunctionPass(ID), timers("DoubleStore") {}
 /**
  * @function runOnFunction override
  * also works with runOnModule
@@ -54,6 +58,7 @@ namespace {
 	 int cpt2 = 0;
 	 bool addStoreSize = false;
 	 int arraySize = 0;
+	 PhaseScope update(timers, "update_storage", F);
          for(BasicBlock &B : F){
 	    for(Instruction &I : B){
 	       storage.push_back(&I);
@@ -83,6 +88,8 @@ namespace {
 	       cpt2++;
 	    }
 	 }
+	 update.stop();
+	 PhaseScope last(timers, "addLastStore", F);
 	 cpt2--;
 	    while(cpt2 >= 0){
 	       //getelementpointerinbounds <~> load:opcode = 32
@@ -109,6 +116,7 @@ namespace {
     * @returns false because the code wasn't modified during its execution
     **/
    bool doFinalization(Module &M) override{
+      timers.report();
       errs() << "\n(Information are displayed in file:line:column mode)\n\n";
       errs() << "\033[0;36m======================================\033[0;0m\n";
       errs() << "\033[0;36m=======   TRACKER STATISTICS   =======\033[0;0m\n";
@@ -196,6 +204,7 @@ namespace {
 	 errs() << "can't do my stuff\n";
       }
       else{
+	 tagScrub(Store0, operand, "DoubleStore", storage[i]);
 	 errs() << "adding STORE 0 (after)\t\t\t";
 	 storage[i]->getDebugLoc().print(errs());
 	 errs() << "\n";
@@ -251,7 +260,7 @@ namespace {
 	   --i;
 	 }
       }
-      //TODO check wether or not it is usefull to store 0 in a global variable after all use
+      //the sensitive global variables are not set to 0 here: PutAtZero gathers them in one section wiped by ScrubRuntime at exit
       else{
 	 if(I.getOpcode() == 30){
 	    if(GlobalVariable* GV = dyn_cast<GlobalVariable>(operand)){ 
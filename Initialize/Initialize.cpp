@@ -22,41 +22,115 @@
 
 
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/Debug.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/Instruction.h"
+#include "llvm/IR/IntrinsicInst.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Analysis/LoopInfo.h"
 #include "llvm/IR/Constants.h"
+#include "PhaseTimer.h"
+#include "PlacementPlan.h"
+#include "ScrubMetadata.h"
 
 
 using namespace llvm;
 
+#define DEBUG_TYPE "initialize"
+#if LLVM_VERSION_MAJOR < 7
+#define LLVM_DEBUG(X) DEBUG(X)
+#endif
+
 namespace {
  struct Initialize : public FunctionPass {
 
    static char ID;
    static int numSTORE0ADDED;//The number of instruction STORE 0 added
 
-   Initialize() : FunctionPass(ID) {}
+   PhaseTimers timers;//-time-passes, -ftime-trace
+   ScrubPlan plan;//the STORE 0 of the current function, decided before any is added
+
+   Initialize() : FunctionPass(ID), timers("Initialize") {}
    bool runOnFunction(Function &F) override {
-      for (BasicBlock &B : F){
-	 Instruction* currentInstruction = nullptr;
-	 for(Instruction &I : B){
-	    if(AllocaInst *AI = dyn_cast<AllocaInst>(&I)){
-	       addStore0(*AI);
+      plan.clear();
+      {
+	 PhaseScope phase(timers, "plan", F);
+	 for (BasicBlock &B : F){
+	    for(Instruction &I : B){
+	       if(AllocaInst *AI = dyn_cast<AllocaInst>(&I)){
+		  std::vector<Instruction*> starts = getLifetimeStarts(AI);
+		  if(starts.empty()){
+		     planStore0(*AI, AI->getNextNode());
+		  }
+		  for(Instruction* start : starts){//before its llvm.lifetime.start, the stack slot might still belong to another variable
+		     planStore0(*AI, start->getNextNode());
+		  }
+	       }
 	    }
 	 }
       }
+      PhaseScope phase(timers, "addStore0", F);
+      std::vector<Instruction*> added(plan.size(), nullptr);
+      for(unsigned i = 0; i < plan.size(); ++i){
+	 added[i] = addStore0(plan[i], plan.getInsertionPoint(i, added, plan[i].place));
+      }
       return false;
    }
 
-
-   void addStore0(AllocaInst &AI){
-      Instruction *NextI = AI.getNextNode();
+   /**
+    * @function planStore0:
+    * @param AI the variable to initialize
+    * @param NextI the instruction the STORE 0 will precede, after the ones already planned there
+    **/
+   void planStore0(AllocaInst &AI, Instruction *NextI){
       if(NextI == nullptr){
 	 return;
       }
+      ScrubPlacement S;
+      S.place = NextI;
+      S.address = &AI;
+      S.type = AI.getType()->getElementType();
+      S.use = &AI;
+      S.pass = "Initialize";
+      plan.add(S);
+   }
+
+
+   /**
+    * @function getLifetimeStarts:
+    * @param AI a variable
+    * @returns the llvm.lifetime.start markers of AI (optimized code)
+    **/
+   std::vector<Instruction*> getLifetimeStarts(AllocaInst* AI){
+      std::vector<Instruction*> starts;
+      std::vector<Value*> addresses(1, AI);
+      for(User* U : AI->users()){
+	 GetElementPtrInst* GEP = dyn_cast<GetElementPtrInst>(U);
+	 if(isa<BitCastInst>(U) || (GEP != nullptr && GEP->hasAllZeroIndices())){//i8* address of the variable
+	    addresses.push_back(U);
+	 }
+      }
+      for(Value* V : addresses){
+	 for(User* U : V->users()){
+	    if(IntrinsicInst* II = dyn_cast<IntrinsicInst>(U)){
+	       if(II->getIntrinsicID() == Intrinsic::lifetime_start){
+		  starts.push_back(II);
+	       }
+	    }
+	 }
+      }
+      return starts;
+   }
+
+   /**
+    * @function addStore0:
+    * @param S a STORE 0 of the plan
+    * @param NextI the instruction it is inserted before
+    * @returns the STORE 0 added, nullptr if the type of the variable is not handled
+    **/
+   Instruction* addStore0(const ScrubPlacement& S, Instruction *NextI){
+      AllocaInst &AI = *cast<AllocaInst>(S.address);
       IRBuilder<> Builder(NextI);
       StoreInst* Store0 =  nullptr;
       int ID = AI.getType()->getElementType()->getTypeID();
@@ -98,12 +172,17 @@ namespace {
 	    Store0 = Builder.CreateStore(Constant::getNullValue(cast<PointerType>(AI.getType()->getElementType())), &AI, true);
 	    break;
 
+#if LLVM_VERSION_MAJOR >= 11
+	 case Type::FixedVectorTyID:
+	 case Type::ScalableVectorTyID:
+#else
 	 case Type::VectorTyID:
+#endif
 	    //Store0 = Builder.CreateStore(ConstantDataVector::get(Type::getVectorTy(Builder.getContext()), 0), I, true);
 	    break;
 	 case Type::ArrayTyID:
 	    ArrayType* array = dyn_cast<ArrayType>(AI.getType()->getElementType());
-	    Builder.CreateStore(Constant::getNullValue(array), &AI, true);
+	    Store0 = Builder.CreateStore(Constant::getNullValue(array), &AI, true);
 	    break;
       }
 
@@ -111,13 +190,13 @@ namespace {
 	 errs() << "can't do my stuff\n";
       }
       else{
-	 if(AI.getDebugLoc()){
-   	    errs() << "adding STORE 0 (after)\t\t\t";
-   	    AI.getDebugLoc().print(errs());
-   	    errs() << "\n";
+	 tagScrub(Store0, &AI, "Initialize", NextI);
+	 if(AI.getDebugLoc()){//-debug-only=initialize
+	    LLVM_DEBUG(dbgs() << "adding STORE 0 (after)\t\t\t"; AI.getDebugLoc().print(dbgs()); dbgs() << "\n");
 	 }
       }
       numSTORE0ADDED++;
+      return Store0;
    }
 
 
@@ -128,6 +207,7 @@ namespace {
     * @returns false because the code wasn't modified during its execution
     **/
    bool doFinalization(Module &M) override{
+      timers.report();
       errs() << "\n(Information are displayed in file:line:column mode)\n\n";
       errs() << "\033[0;36m======================================\033[0;0m\n";
       errs() << "\033[0;36m=======   TRACKER STATISTICS   =======\033[0;0m\n";
@@ -0,0 +1,324 @@
+/**
+ * paz-batch: runs the PutAtZero pass over a list of modules in a single process.
+ * Launching opt -load LLVMPutAtZero.so -PaZ once per file spends most of its time starting the process and loading the plugin;
+ * here the pass is linked in the tool and the modules are shared out between worker threads, each one with its own LLVMContext.
+ *
+ *	paz-batch -PaZ -j 8 -output-dir out/ a.bc b.bc ...
+ *	paz-batch -PaZ -paz-optimized -input-list files.txt -output-dir out/
+ *	paz-batch -PaZ -paz-estimate -lazy -disable-output huge.bc
+ *
+ * The options of the pass (-paz-...) are accepted as with opt.
+ * @author INRIA Bordeaux STORM Project Team
+ **/
+
+#include "llvm/Bitcode/BitcodeWriterPass.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/ADT/Triple.h"
+#include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/IR/IRPrintingPasses.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/LegacyPassNameParser.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/InitializePasses.h"
+#include "llvm/PassRegistry.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Signals.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "PutAtZero.h"
+
+using namespace llvm;
+
+static cl::list<const PassInfo*, bool, PassNameParser> PassList(cl::desc("Passes to run on each module (in this order):"));
+
+static cl::list<std::string> InputFiles(cl::Positional, cl::desc("<input modules>"), cl::ZeroOrMore);
+
+static cl::opt<std::string> InputList("input-list", cl::desc("file giving the input modules, one per line"), cl::value_desc("filename"));
+
+static cl::opt<std::string> OutputDir("output-dir", cl::desc("directory where the modules are written, under the name of their input file"), cl::value_desc("directory"), cl::init("."));
+
+static cl::opt<std::string> OutputSuffix("output-suffix", cl::desc("added to the name of the input file (for an output directory which is also the input one)"), cl::init(""));
+
+static cl::opt<bool> OutputAssembly("S", cl::desc("write the modules as LLVM assembly instead of bitcode"), cl::init(false));
+
+static cl::opt<bool> DisableOutput("disable-output", cl::desc("the modules are not written (analysis only, -paz-estimate)"), cl::init(false));
+
+static cl::opt<bool> Lazy("lazy", cl::desc("the functions are read from the bitcode one at a time, when the passes reach them (function passes only); with -disable-output each one is deleted once handled, the memory is only bounded without output"), cl::init(false));
+
+static cl::opt<unsigned> Threads("j", cl::desc("number of worker threads (0: one per hardware thread)"), cl::init(0));
+
+struct FileResult{
+   double seconds;
+   bool done;
+   std::string error;//why the module was not written
+};
+
+/**
+ * @function readInputList:
+ * adds the names given in the file -input-list to the input modules
+ * @param files the input modules
+ * @returns false if the file could not be read
+ **/
+static bool readInputList(std::vector<std::string> &files){
+   ErrorOr<std::unique_ptr<MemoryBuffer>> buffer = MemoryBuffer::getFile(InputList);
+   if(!buffer){
+      errs() << "paz-batch: cannot read " << InputList << ": " << buffer.getError().message() << "\n";
+      return false;
+   }
+   SmallVector<StringRef, 64> lines;
+   (*buffer)->getBuffer().split(lines, '\n', -1, false);
+   for(StringRef line : lines){
+      line = line.trim();
+      if(!line.empty() && !line.startswith("#")){
+	 files.push_back(line.str());
+      }
+   }
+   return true;
+}
+
+/**
+ * @function getOutputName:
+ * @param input the name of an input module
+ * @returns the name of its output in -output-dir
+ **/
+static std::string getOutputName(const std::string &input){
+   SmallString<256> output(OutputDir);
+   sys::path::append(output, sys::path::stem(input) + OutputSuffix);
+   output += OutputAssembly ? ".ll" : ".bc";
+   return std::string(output.str());
+}
+
+/**
+ * @function materialize:
+ * reads the body of a function (or of all the module) from the bitcode
+ * @param F the function, or nullptr for the whole module
+ * @param M the module
+ * @param result where the error is kept
+ * @returns false if the bitcode could not be read
+ **/
+static bool materialize(Function* F, Module &M, FileResult &result){
+#if LLVM_VERSION_MAJOR >= 4
+   Error E = F != nullptr ? F->materialize() : M.materializeAll();
+   if(E){
+      result.error = toString(std::move(E));
+      return false;
+   }
+#else
+   std::error_code EC = F != nullptr ? F->materialize() : M.materializeAll();
+   if(EC){
+      result.error = EC.message();
+      return false;
+   }
+#endif
+   return true;
+}
+
+/**
+ * @function streamFunctions:
+ * runs the passes on the functions of a lazily loaded module: each function is only read when the passes reach it.
+ * With -disable-output the body is deleted once handled, so the memory holds a single function at a time.
+ * When the module is written, the bodies stay until the writer runs: the bitcode writer needs the whole module, so the memory is not bounded.
+ * The functions which are not read yet are unknown callees for the summaries of PutAtZero (their arguments are considered as kept).
+ * @param M the module, opened with getLazyIRFileModule
+ * @param TLII the library functions of its target
+ * @param result the error
+ * @returns false if a pass is not a function pass or if the bitcode could not be read
+ **/
+static bool streamFunctions(Module &M, TargetLibraryInfoImpl &TLII, FileResult &result){
+   legacy::FunctionPassManager FPM(&M);
+   FPM.add(new TargetLibraryInfoWrapperPass(TLII));
+   for(const PassInfo* PI : PassList){
+      Pass* P = PI->createPass();
+      if(P->getPassKind() != PT_Function){
+	 result.error = std::string("-lazy only runs function passes, not -") + PI->getPassArgument().str();
+	 delete P;
+	 return false;
+      }
+      FPM.add(P);
+   }
+   FPM.doInitialization();
+   for(Function &F : M){//the functions added by the passes (cold parts) are at the end of the list
+      if(F.isMaterializable() && !materialize(&F, M, result)){
+	 return false;
+      }
+      if(F.isDeclaration()){
+	 continue;
+      }
+      FPM.run(F);
+      if(DisableOutput){
+	 F.deleteBody();
+      }
+   }
+   FPM.doFinalization();
+   return DisableOutput || materialize(nullptr, M, result);//the writer needs the rest of the module (metadata...): with an output, all of it is in memory by now
+}
+
+/**
+ * @function processFile:
+ * reads a module, runs the passes on it and writes it
+ * @param input the name of the module
+ * @param context the context of the worker thread
+ * @param result the timing and the error of the module
+ * @returns nothing
+ **/
+static void processFile(const std::string &input, LLVMContext &context, FileResult &result){
+   auto begin = std::chrono::steady_clock::now();
+   SMDiagnostic diagnostic;
+   std::unique_ptr<Module> M = Lazy ? getLazyIRFileModule(input, diagnostic, context) : parseIRFile(input, diagnostic, context);
+   if(!M){
+      raw_string_ostream message(result.error);
+      diagnostic.print("paz-batch", message, false);
+      return;
+   }
+   std::unique_ptr<raw_fd_ostream> out;
+   if(!DisableOutput){
+      std::error_code EC;
+#if LLVM_VERSION_MAJOR >= 9
+      out.reset(new raw_fd_ostream(getOutputName(input), EC, OutputAssembly ? sys::fs::OF_Text : sys::fs::OF_None));
+#else
+      out.reset(new raw_fd_ostream(getOutputName(input), EC, OutputAssembly ? sys::fs::F_Text : sys::fs::F_None));
+#endif
+      if(EC){
+	 result.error = getOutputName(input) + ": " + EC.message();
+	 return;
+      }
+   }
+   legacy::PassManager PM;
+   TargetLibraryInfoImpl TLII(Triple(M->getTargetTriple()));
+   PM.add(new TargetLibraryInfoWrapperPass(TLII));
+   if(Lazy){
+      if(!streamFunctions(*M, TLII, result)){
+	 return;
+      }
+   }
+   else{
+      for(const PassInfo* PI : PassList){
+	 PM.add(PI->createPass());
+      }
+   }
+   PM.run(*M);
+   if(out){
+      raw_string_ostream message(result.error);
+      if(verifyModule(*M, &message)){//the other modules go on: the broken one is reported and not written
+	 message.flush();
+	 out.reset();
+	 sys::fs::remove(getOutputName(input));
+	 return;
+      }
+      legacy::PassManager writer;
+      if(OutputAssembly){
+	 writer.add(createPrintModulePass(*out));
+      }
+      else{
+	 writer.add(createBitcodeWriterPass(*out));
+      }
+      writer.run(*M);
+   }
+   result.done = true;
+   result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+/**
+ * @function report:
+ * displays the time spent on each module, then the totals and the statistics of the passes
+ * @param files the input modules
+ * @param results their results, in the same order
+ * @param workers the number of worker threads
+ * @param seconds the wall clock time of the whole batch
+ * @returns the number of modules which failed
+ **/
+static unsigned report(const std::vector<std::string> &files, const std::vector<FileResult> &results, unsigned workers, double seconds){
+   errs() << "\033[0;36m======================================\033[0;0m\n";
+   errs() << "\033[0;36m=======       PAZ BATCH        =======\033[0;0m\n";
+   errs() << "\033[0;36m======================================\033[0;0m\n";
+   errs() << "     seconds   module\n";
+   unsigned failed = 0;
+   double total = 0;
+   for(size_t i = 0; i < files.size(); ++i){
+      if(!results[i].done){
+	 errs() << "      failed   " << files[i] << "\n";
+	 errs() << results[i].error << "\n";
+	 failed++;
+	 continue;
+      }
+      errs() << format("%12.4f   ", results[i].seconds) << files[i] << "\n";
+      total += results[i].seconds;
+   }
+   errs() << "\033[0;32m " << files.size() - failed << " modules written, " << failed << " failed\033[0;0m\n";
+   errs() << "\033[0;32m " << format("%.3f", total) << " s spent in the modules, " << format("%.3f", seconds) << " s elapsed with " << workers << " threads\033[0;0m\n";
+   for(const PassInfo* PI : PassList){
+      if(PI->getPassArgument() == "PaZ"){
+	 printPutAtZeroStatistics();
+      }
+   }
+   return failed;
+}
+
+int main(int argc, char** argv){
+   sys::PrintStackTraceOnErrorSignal(argv[0]);
+   llvm_shutdown_obj shutdown;
+   PassRegistry &registry = *PassRegistry::getPassRegistry();
+   initializeCore(registry);
+   initializeAnalysis(registry);
+   initializeTransformUtils(registry);
+
+   //the statistics of PutAtZero are displayed once for all the modules, not by each pass manager
+   std::vector<const char*> args(argv, argv + argc);
+   args.push_back("-paz-quiet");
+   cl::ParseCommandLineOptions(args.size(), args.data(), "PutAtZero batch driver\n");
+
+   std::vector<std::string> files(InputFiles.begin(), InputFiles.end());
+   if(!InputList.empty() && !readInputList(files)){
+      return 1;
+   }
+   if(files.empty()){
+      errs() << "paz-batch: no input module\n";
+      return 1;
+   }
+   if(Lazy && !DisableOutput){
+      errs() << "paz-batch: -lazy without -disable-output, each module is held whole in memory until it is written\n";
+   }
+   if(std::error_code EC = sys::fs::create_directories(OutputDir)){
+      errs() << "paz-batch: cannot create " << OutputDir << ": " << EC.message() << "\n";
+      return 1;
+   }
+
+   unsigned workers = Threads;
+   if(workers == 0){
+      workers = std::max(1u, std::thread::hardware_concurrency());
+   }
+   workers = std::min<size_t>(workers, files.size());
+
+   std::vector<FileResult> results(files.size(), FileResult{0, false, ""});
+   std::atomic<size_t> next(0);
+   auto begin = std::chrono::steady_clock::now();
+   std::vector<std::thread> pool;
+   for(unsigned i = 0; i < workers; ++i){
+      pool.emplace_back([&](){
+	 LLVMContext context;//a context is never shared between threads, it is reused for all the modules of its worker
+	 for(size_t file = next++; file < files.size(); file = next++){
+	    processFile(files[file], context, results[file]);
+	 }
+      });
+   }
+   for(std::thread &worker : pool){
+      worker.join();
+   }
+   double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+   return report(files, results, workers, seconds) == 0 ? 0 : 1;
+}
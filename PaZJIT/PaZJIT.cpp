@@ -0,0 +1,127 @@
+/**
+ * The scrubbing passes in an ORC JIT: each module given to the IRTransformLayer goes through a legacy pass manager
+ * running the passes of PaZJITOptions before being compiled.
+ * @author INRIA Bordeaux STORM Project Team
+ **/
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/Triple.h"
+#include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/InitializePasses.h"
+#include "llvm/PassRegistry.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <set>
+#include "PutAtZero.h"
+#include "SensitiveGlobals.h"
+#include "PaZJIT.h"
+
+using namespace llvm;
+
+static std::once_flag initialized;
+
+/**
+ * @function PaZTransform:
+ * registers the analysis the passes depend on, once per process,
+ * and silences the statistics PutAtZero displays after each module: report() displays them once for all the modules
+ * @param options the passes and the latency mode
+ **/
+PaZTransform::PaZTransform(PaZJITOptions options) : options(options), statistics(std::make_shared<PaZJITStatistics>()) {
+   std::call_once(initialized, [](){
+      PassRegistry &registry = *PassRegistry::getPassRegistry();
+      initializeCore(registry);
+      initializeAnalysis(registry);
+      initializeTransformUtils(registry);
+      StringMap<cl::Option*> &registered = cl::getRegisteredOptions();
+      auto quiet = registered.find("paz-quiet");
+      if(quiet != registered.end()){
+	 static_cast<cl::opt<bool>*>(quiet->second)->setValue(true);
+      }
+   });
+}
+
+/**
+ * @function transform:
+ * runs the passes on a module about to be compiled and records the time they took
+ * @param M the module
+ * @returns nothing but M is instrumented
+ **/
+void PaZTransform::transform(Module& M){
+   auto begin = std::chrono::steady_clock::now();
+   if(options.latencyBounded){
+      boundLatency(M);
+   }
+   legacy::PassManager PM;
+   TargetLibraryInfoImpl TLII(Triple(M.getTargetTriple()));
+   PM.add(new TargetLibraryInfoWrapperPass(TLII));
+   for(const std::string &name : options.passes){
+      const PassInfo* PI = PassRegistry::getPassRegistry()->getPassInfo(name);
+      if(PI == nullptr){
+	 errs() << "PaZJIT: unknown pass " << name << "\n";
+	 continue;
+      }
+      PM.add(PI->createPass());
+   }
+   PM.run(M);
+   double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+   std::lock_guard<std::mutex> guard(statistics->lock);
+   statistics->modules.push_back(std::make_pair(M.getModuleIdentifier(), seconds));
+   statistics->seconds += seconds;
+   statistics->slowest = std::max(statistics->slowest, seconds);
+   if(options.verbose){
+      errs() << "PaZJIT: " << format("%.1f", seconds * 1e6) << " us in " << M.getModuleIdentifier() << "\n";
+   }
+}
+
+/**
+ * @function boundLatency:
+ * gives the cheap tier to the functions which do not have a tier of their own (paz.tier metadata, "paz-tier" attribute, paz_tier=<tier> annotation)
+ * @param M the module
+ * @returns nothing
+ **/
+void PaZTransform::boundLatency(Module& M){
+   std::set<const Function*> annotated;
+   for(auto &annotation : getGlobalAnnotations(M)){
+      if(isa<Function>(annotation.first) && StringRef(annotation.second).startswith("paz_tier=")){
+	 annotated.insert(cast<Function>(annotation.first));
+      }
+   }
+   for(Function &F : M){
+      if(F.isDeclaration() || F.hasFnAttribute("paz-tier") || F.getMetadata("paz.tier") != nullptr || annotated.count(&F)){
+	 continue;
+      }
+      F.addFnAttr("paz-tier", options.boundedTier);
+   }
+}
+
+/**
+ * @function report:
+ * displays the time spent in each module, the totals and the statistics of PutAtZero
+ * @param out the stream
+ * @returns nothing
+ **/
+void PaZTransform::report(raw_ostream& out) const{
+   std::lock_guard<std::mutex> guard(statistics->lock);
+   out << "\033[0;36m======================================\033[0;0m\n";
+   out << "\033[0;36m=======         PAZ JIT        =======\033[0;0m\n";
+   out << "\033[0;36m======================================\033[0;0m\n";
+   out << "   microseconds   module\n";
+   for(auto &module : statistics->modules){
+      out << format("%15.1f   ", module.second * 1e6) << module.first << "\n";
+   }
+   double average = statistics->modules.empty() ? 0 : statistics->seconds / statistics->modules.size();
+   out << "\033[0;32m " << statistics->modules.size() << " modules, " << format("%.1f", average * 1e6) << " us on average, "
+       << format("%.1f", statistics->slowest * 1e6) << " us for the slowest\033[0;0m\n";
+   for(const std::string &name : options.passes){
+      if(name == "PaZ"){
+	 printPutAtZeroStatistics();
+      }
+   }
+}
@@ -0,0 +1,77 @@
+#ifndef PAZJIT_H
+#define PAZJIT_H
+
+/**
+ * Adapter running the scrubbing passes on the modules compiled by an ORC JIT, as the transform of an IRTransformLayer:
+ *
+ *	ORC v2 (LLVM >= 10):
+ *	   PaZTransform scrub(options);
+ *	   J->getIRTransformLayer().setTransform(scrub);
+ *	ORC v1:
+ *	   IRTransformLayer<decltype(CompileLayer), PaZTransform> ScrubLayer(CompileLayer, PaZTransform(options));
+ *
+ * The copies of a PaZTransform share their statistics, report() displays the time spent in each module.
+ * @author INRIA Bordeaux STORM Project Team
+ **/
+
+#include "llvm/Config/llvm-config.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/raw_ostream.h"
+#if LLVM_VERSION_MAJOR >= 10
+#include "llvm/ExecutionEngine/Orc/ThreadSafeModule.h"
+#endif
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct PaZJITOptions{
+   std::vector<std::string> passes;//the passes run on each module, by their name (-PaZ...)
+   bool latencyBounded;//the functions without a tier of their own are given boundedTier: linear time, a few microseconds per function
+   std::string boundedTier;//exit or balanced
+   bool verbose;//the time spent in each module is displayed as soon as it is compiled
+
+   PaZJITOptions() : passes(1, "PaZ"), latencyBounded(false), boundedTier("exit"), verbose(false) {}
+};
+
+struct PaZJITStatistics{
+   std::mutex lock;//the JIT may compile several modules at once
+   std::vector<std::pair<std::string, double>> modules;//each module compiled and the seconds spent in the passes
+   double seconds;
+   double slowest;
+
+   PaZJITStatistics() : seconds(0), slowest(0) {}
+};
+
+class PaZTransform{
+ public:
+   explicit PaZTransform(PaZJITOptions options = PaZJITOptions());
+
+   void transform(llvm::Module& M);
+   void report(llvm::raw_ostream& out) const;
+
+#if LLVM_VERSION_MAJOR >= 10
+   //ORC v2: the MaterializationResponsibility is const until LLVM 11
+   template<typename ResponsibilityT>
+   llvm::Expected<llvm::orc::ThreadSafeModule> operator()(llvm::orc::ThreadSafeModule TSM, ResponsibilityT&){
+      TSM.withModuleDo([this](llvm::Module& M){ transform(M); });
+      return std::move(TSM);
+   }
+#endif
+
+   //ORC v1: std::unique_ptr<Module> (LLVM 3.9, 4) or std::shared_ptr<Module> (LLVM 5 to 8)
+   template<typename ModulePtrT>
+   ModulePtrT operator()(ModulePtrT M){
+      transform(*M);
+      return M;
+   }
+
+ private:
+   PaZJITOptions options;
+   std::shared_ptr<PaZJITStatistics> statistics;
+
+   void boundLatency(llvm::Module& M);
+};
+
+#endif
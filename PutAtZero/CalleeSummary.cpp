@@ -0,0 +1,286 @@
+/**
+ * Bottom-up summaries of what each function does with the memory pointed by its arguments.
+ * The PutAtZero pass uses them when the address of a variable is given to a call:
+ * if the callee does not keep the pointer, the variable can be set to 0 right after the call.
+ * @author INRIA Bordeaux STORM Project Team
+ **/
+
+#include "llvm/ADT/SCCIterator.h"
+#include "llvm/Analysis/CallGraph.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include <algorithm>
+#include "CallCompat.h"
+#include "CalleeSummary.h"
+
+using namespace llvm;
+
+struct BuiltinSummary{
+   const char* name;
+   unsigned args[3];//the effect on the first three arguments
+   unsigned others;//the effect on the following ones (variadic functions)
+   int length;//the argument giving the maximal number of bytes written through the pointer arguments, -1 if none
+   bool exact;//true if the first argument always gets exactly length bytes written (memcpy), false if the callee only might write them (scanf, strncpy)
+   bool returnsFirst;//true if the callee returns its first argument (strcpy, memcpy): the pointer is kept as long as the result is used
+};
+
+//the usual libc functions which are only declared in the module
+//none of them stores the pointers it is given, but some return their first argument (captures when the result is used)
+//and strtol stores a pointer into its first argument through the second one (captures)
+static const BuiltinSummary builtins[] = {
+   {"printf",	{reads, reads, reads},		reads,	-1,	false,	false},
+   {"fprintf",	{noEffect, reads, reads},	reads,	-1,	false,	false},
+   {"sprintf",	{writes, reads, reads},		reads,	-1,	false,	false},
+   {"snprintf",	{writes, noEffect, reads},	reads,	1,	false,	false},
+   {"puts",	{reads, noEffect, noEffect},	noEffect,	-1,	false,	false},
+   {"fputs",	{reads, noEffect, noEffect},	noEffect,	-1,	false,	false},
+   {"scanf",	{reads, writes, writes},	writes,	-1,	false,	false},
+   {"sscanf",	{reads, reads, writes},		writes,	-1,	false,	false},
+   {"strlen",	{reads, noEffect, noEffect},	noEffect,	-1,	false,	false},
+   {"strcmp",	{reads, reads, noEffect},	noEffect,	-1,	false,	false},
+   {"strncmp",	{reads, reads, noEffect},	noEffect,	-1,	false,	false},
+   {"memcmp",	{reads, reads, noEffect},	noEffect,	-1,	false,	false},
+   {"strcpy",	{writes, reads, noEffect},	noEffect,	-1,	false,	true},
+   {"strncpy",	{writes, reads, noEffect},	noEffect,	2,	false,	true},
+   {"strcat",	{reads | writes, reads, noEffect},	noEffect,	-1,	false,	true},
+   {"memcpy",	{writes, reads, noEffect},	noEffect,	2,	true,	true},
+   {"memmove",	{writes, reads, noEffect},	noEffect,	2,	true,	true},
+   {"memset",	{writes, noEffect, noEffect},	noEffect,	2,	true,	true},
+   {"atoi",	{reads, noEffect, noEffect},	noEffect,	-1,	false,	false},
+   {"fgets",	{writes, noEffect, noEffect},	noEffect,	1,	false,	true},
+   {"read",	{noEffect, writes, noEffect},	noEffect,	2,	false,	false},
+   {"strtol",	{reads | captures, writes, noEffect},	noEffect,	-1,	false,	false},
+   {"llvm.memcpy",	{writes, reads, noEffect},	noEffect,	2,	true,	false},
+   {"llvm.memmove",	{writes, reads, noEffect},	noEffect,	2,	true,	false},
+   {"llvm.memset",	{writes, noEffect, noEffect},	noEffect,	2,	true,	false},
+   {"llvm.lifetime",	{noEffect, noEffect, noEffect},	noEffect,	-1,	false,	false},
+   {"llvm.dbg",		{noEffect, noEffect, noEffect},	noEffect,	-1,	false,	false},
+};
+
+/**
+ * @function compute:
+ * computes the summaries of all the functions defined in the module, callees first.
+ * The functions of a same strongly connected component (recursive calls) are summarized again until nothing changes.
+ * @param M the current module
+ * @returns nothing but every defined function has its summary
+ **/
+void CalleeSummaries::compute(Module& M){
+   summaries.clear();
+   CallGraph CG(M);
+   for(scc_iterator<CallGraph*> it = scc_begin(&CG); !it.isAtEnd(); ++it){//post order: the callees come before their callers
+      const std::vector<CallGraphNode*> &SCC = *it;
+      bool changed = true;
+      while(changed){
+	 changed = false;
+	 for(CallGraphNode* node : SCC){
+	    Function* F = node->getFunction();
+	    if(F != nullptr && !F->isDeclaration() && !F->isMaterializable()){//a function not read yet from the bitcode (paz-batch -lazy) stays unknown
+	       changed |= summarize(*F);
+	    }
+	 }
+      }
+   }
+}
+
+/**
+ * @function getEffect:
+ * @param CI a call instruction
+ * @param argNo the position of the argument in the call
+ * @returns the effect of the callee over the memory pointed by the argument argNo, allEffects if nothing is known
+ **/
+unsigned CalleeSummaries::getEffect(CallInst* CI, unsigned argNo){
+   Function* callee = CI->getCalledFunction();
+   if(callee == nullptr){//indirect call
+      return allEffects;
+   }
+   auto it = summaries.find(callee);
+   if(it != summaries.end()){
+      if(argNo < it->second.size()){
+	 return it->second[argNo];
+      }
+      return allEffects;//variadic arguments of a defined function
+   }
+   bool known = false;
+   unsigned effect = getBuiltinEffect(callee->getName(), argNo, known);
+   if(known){
+      if(argNo == 0 && !CI->use_empty() && getBuiltin(callee->getName())->returnsFirst){//p = strcpy(buf, s): buf is used through p
+	 effect |= captures;
+      }
+      return effect;
+   }
+   return allEffects;
+}
+
+/**
+ * @function getWriteLength:
+ * @param CI a call instruction
+ * @returns the position of the argument bounding the number of bytes the callee writes (memcpy, strncpy, snprintf...), -1 if there is none or if the callee is not a builtin
+ **/
+int CalleeSummaries::getWriteLength(CallInst* CI){
+   Function* callee = CI->getCalledFunction();
+   if(callee == nullptr || summaries.count(callee)){
+      return -1;
+   }
+   const BuiltinSummary* builtin = getBuiltin(callee->getName());
+   if(builtin == nullptr || builtin->length >= (int)getNumCallArgs(CI)){
+      return -1;
+   }
+   return builtin->length;
+}
+
+/**
+ * @function isMustWrite:
+ * @param CI a call instruction
+ * @param argNo the position of the argument in the call
+ * @param size the size of the memory pointed by the argument
+ * @returns true if the callee always overwrites the size first bytes pointed by the argument argNo (memset of the whole variable), false if it only might write them
+ **/
+bool CalleeSummaries::isMustWrite(CallInst* CI, unsigned argNo, uint64_t size){
+   int lengthArg = getWriteLength(CI);
+   if(argNo != 0 || lengthArg < 0 || !getBuiltin(CI->getCalledFunction()->getName())->exact){
+      return false;
+   }
+   ConstantInt* length = dyn_cast<ConstantInt>(CI->getArgOperand(lengthArg));
+   return length != nullptr && length->getZExtValue() >= size;
+}
+
+/**
+ * @function getBuiltinEffect:
+ * @param name the name of a declared function
+ * @param argNo the position of the argument
+ * @param known set to true if the function is one of the builtins
+ * @returns the effect of the builtin over its argument argNo
+ **/
+unsigned CalleeSummaries::getBuiltinEffect(StringRef name, unsigned argNo, bool& known){
+   const BuiltinSummary* builtin = getBuiltin(name);
+   known = builtin != nullptr;
+   if(builtin == nullptr){
+      return allEffects;
+   }
+   if(argNo < 3){
+      return builtin->args[argNo];
+   }
+   return builtin->others;
+}
+
+/**
+ * @function getBuiltin:
+ * @param name the name of a declared function
+ * @returns its entry in the table of builtins, nullptr if there is none
+ **/
+const BuiltinSummary* CalleeSummaries::getBuiltin(StringRef name){
+   for(const BuiltinSummary &builtin : builtins){
+      StringRef builtinName(builtin.name);
+      //the intrinsics are overloaded (llvm.memcpy.p0i8.p0i8.i64) so only their prefix is compared
+      if(name == builtinName || (builtinName.startswith("llvm.") && name.startswith(builtinName.str() + "."))){
+	 return &builtin;
+      }
+   }
+   return nullptr;
+}
+
+/**
+ * @function summarize:
+ * (re)computes the summary of a function from the uses of its pointer arguments
+ * @param F a defined function
+ * @returns true if the summary changed
+ **/
+bool CalleeSummaries::summarize(Function& F){
+   Summary summary;
+   for(Argument &A : F.args()){
+      std::vector<Value*> visited;
+      if(A.getType()->isPointerTy()){
+	 summary.push_back(getPointerEffect(&A, visited));
+      }
+      else{
+	 summary.push_back(noEffect);
+      }
+   }
+   auto it = summaries.find(&F);
+   if(it != summaries.end() && it->second == summary){
+      return false;
+   }
+   summaries[&F] = summary;
+   return true;
+}
+
+/**
+ * @function getPointerEffect:
+ * follows the uses of a pointer to know what is done with the pointed memory
+ * @param V the pointer
+ * @param visited the values already followed (phi nodes might loop)
+ * @returns the mask of ArgEffect of all the uses of V
+ **/
+unsigned CalleeSummaries::getPointerEffect(Value* V, std::vector<Value*>& visited){
+   if(std::find(visited.begin(), visited.end(), V) != visited.end()){
+      return noEffect;
+   }
+   visited.push_back(V);
+   unsigned effect = noEffect;
+   for(User* U : V->users()){
+      if(isa<LoadInst>(U)){
+	 effect |= reads;
+      }
+      else if(StoreInst* SI = dyn_cast<StoreInst>(U)){
+	 if(SI->getPointerOperand() == V){
+	    effect |= writes;
+	 }
+	 if(SI->getValueOperand() == V){//the pointer itself is stored
+	    AllocaInst* AI = dyn_cast<AllocaInst>(SI->getPointerOperand());
+	    if(AI == nullptr){
+	       return allEffects;
+	    }
+	    effect |= getSpilledPointerEffect(AI, visited);//unoptimized code always stores its arguments in a local variable first
+	 }
+      }
+      else if(isa<BitCastInst>(U) || isa<GetElementPtrInst>(U) || isa<PHINode>(U) || isa<SelectInst>(U)){
+	 effect |= getPointerEffect(U, visited);
+      }
+      else if(CallInst* CI = dyn_cast<CallInst>(U)){
+	 if(getCalledPointer(CI) == V){
+	    return allEffects;
+	 }
+	 for(unsigned i = 0; i < getNumCallArgs(CI); ++i){
+	    if(CI->getArgOperand(i) == V){
+	       effect |= getEffect(CI, i);
+	    }
+	 }
+      }
+      else if(!isa<ICmpInst>(U)){//returned, converted to an integer... we lose track of it
+	 return allEffects;
+      }
+      if(effect == allEffects){
+	 return effect;
+      }
+   }
+   return effect;
+}
+
+/**
+ * @function getSpilledPointerEffect:
+ * follows a pointer through the local variable it was stored in
+ * @param AI the local variable holding the pointer
+ * @param visited the values already followed
+ * @returns the mask of ArgEffect of the pointers loaded from AI, allEffects if the address of AI itself escapes
+ **/
+unsigned CalleeSummaries::getSpilledPointerEffect(AllocaInst* AI, std::vector<Value*>& visited){
+   if(std::find(visited.begin(), visited.end(), AI) != visited.end()){
+      return noEffect;
+   }
+   visited.push_back(AI);
+   unsigned effect = noEffect;
+   for(User* U : AI->users()){
+      if(LoadInst* LI = dyn_cast<LoadInst>(U)){
+	 effect |= getPointerEffect(LI, visited);
+      }
+      else if(StoreInst* SI = dyn_cast<StoreInst>(U)){
+	 if(SI->getValueOperand() == AI){
+	    return allEffects;
+	 }
+      }
+      else{
+	 return allEffects;
+      }
+   }
+   return effect;
+}
@@ -0,0 +1,39 @@
+#ifndef CALLEESUMMARY_H
+#define CALLEESUMMARY_H
+
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Instructions.h"
+#include <map>
+#include <vector>
+
+enum ArgEffect{noEffect = 0, reads = 1, writes = 2, captures = 4};
+//what a function does with the memory pointed by one of its arguments
+//reads    -> the pointed value is loaded
+//writes   -> the pointed value might be overwritten (a conditional store, scanf)
+//captures -> the pointer is kept (stored in memory, returned...) and might be used once the call is over
+
+const unsigned allEffects = reads | writes | captures;
+
+typedef std::vector<unsigned> Summary;
+//each argument of a function has a mask of ArgEffect
+
+struct BuiltinSummary;
+
+class CalleeSummaries{
+ public:
+   void compute(llvm::Module& M);
+   unsigned getEffect(llvm::CallInst* CI, unsigned argNo);
+   int getWriteLength(llvm::CallInst* CI);
+   bool isMustWrite(llvm::CallInst* CI, unsigned argNo, uint64_t size);
+
+ private:
+   std::map<const llvm::Function*, Summary> summaries;
+
+   bool summarize(llvm::Function& F);
+   unsigned getBuiltinEffect(llvm::StringRef name, unsigned argNo, bool& known);
+   const BuiltinSummary* getBuiltin(llvm::StringRef name);
+   unsigned getPointerEffect(llvm::Value* V, std::vector<llvm::Value*>& visited);
+   unsigned getSpilledPointerEffect(llvm::AllocaInst* AI, std::vector<llvm::Value*>& visited);
+};
+
+#endif
@@ -0,0 +1,206 @@
+/**
+ * Where the variables with lifetime markers are alive, so that the STORE 0 do not make their stack slots overlap:
+ * a STORE 0 after llvm.lifetime.end (or before llvm.lifetime.start) would keep StackColoring from sharing the slot and the frame would grow.
+ * @author INRIA Bordeaux STORM Project Team
+ **/
+
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/DataLayout.h"
+#include "llvm/IR/Module.h"
+#include "Lifetimes.h"
+
+using namespace llvm;
+
+/**
+ * @function getMarkedVariable:
+ * @returns the variable of a lifetime marker, nullptr if I is not a marker
+ **/
+static AllocaInst* getMarkedVariable(Instruction* I, Intrinsic::ID &ID){
+   IntrinsicInst* II = dyn_cast<IntrinsicInst>(I);
+   if(II == nullptr){
+      return nullptr;
+   }
+   ID = II->getIntrinsicID();
+   if(ID != Intrinsic::lifetime_start && ID != Intrinsic::lifetime_end){
+      return nullptr;
+   }
+   return dyn_cast<AllocaInst>(II->getArgOperand(1)->stripPointerCasts());
+}
+
+/**
+ * @function compute:
+ * finds the markers of each variable and where the variables may be alive (forward dataflow until nothing changes)
+ * @param F the current function
+ **/
+void LifetimeMarkers::compute(Function& F){
+   starts.clear();
+   ends.clear();
+   aliveIn.clear();
+   startedIn.clear();
+   for(BasicBlock &BB : F){
+      for(Instruction &I : BB){
+	 Intrinsic::ID ID;
+	 if(AllocaInst* AI = getMarkedVariable(&I, ID)){
+	    if(ID == Intrinsic::lifetime_start){
+	       starts[AI].push_back(cast<IntrinsicInst>(&I));
+	    }
+	    else{
+	       ends[AI].push_back(cast<IntrinsicInst>(&I));
+	    }
+	 }
+      }
+   }
+   if(starts.empty()){
+      return;
+   }
+   std::map<const BasicBlock*, Variables> aliveOut;
+   std::map<const BasicBlock*, Variables> startedOut;
+   bool changed = true;
+   while(changed){
+      changed = false;
+      for(BasicBlock &BB : F){
+	 Variables alive;
+	 Variables started;
+	 for(auto it = pred_begin(&BB), et = pred_end(&BB); it != et; ++it){
+	    alive.insert(aliveOut[*it].begin(), aliveOut[*it].end());
+	    started.insert(startedOut[*it].begin(), startedOut[*it].end());
+	 }
+	 aliveIn[&BB] = alive;
+	 startedIn[&BB] = started;
+	 for(Instruction &I : BB){
+	    transfer(&I, alive, started);
+	 }
+	 if(alive != aliveOut[&BB] || started != startedOut[&BB]){
+	    aliveOut[&BB] = alive;
+	    startedOut[&BB] = started;
+	    changed = true;
+	 }
+      }
+   }
+}
+
+void LifetimeMarkers::transfer(Instruction* I, Variables& alive, Variables& started){
+   Intrinsic::ID ID;
+   if(AllocaInst* AI = getMarkedVariable(I, ID)){
+      if(ID == Intrinsic::lifetime_start){
+	 alive.insert(AI);
+	 started.insert(AI);
+      }
+      else{
+	 alive.erase(AI);
+      }
+   }
+}
+
+bool LifetimeMarkers::hasMarkers(AllocaInst* AI){
+   return starts.count(AI) != 0;
+}
+
+/**
+ * @function isAlive:
+ * @returns true if AI may be alive right before I (or if it has no marker, then it is alive in the whole function)
+ **/
+bool LifetimeMarkers::isAlive(AllocaInst* AI, Instruction* I){
+   if(!hasMarkers(AI)){
+      return true;
+   }
+   Variables alive = aliveIn[I->getParent()];
+   Variables started = startedIn[I->getParent()];
+   for(Instruction &J : *I->getParent()){
+      if(&J == I){
+	 break;
+      }
+      transfer(&J, alive, started);
+   }
+   return alive.count(AI) != 0;
+}
+
+/**
+ * @function isStarted:
+ * @returns true if a lifetime.start of AI may have been executed before I
+ **/
+bool LifetimeMarkers::isStarted(AllocaInst* AI, Instruction* I){
+   Variables alive = aliveIn[I->getParent()];
+   Variables started = startedIn[I->getParent()];
+   for(Instruction &J : *I->getParent()){
+      if(&J == I){
+	 break;
+      }
+      transfer(&J, alive, started);
+   }
+   return started.count(AI) != 0;
+}
+
+const std::vector<IntrinsicInst*>& LifetimeMarkers::getStarts(AllocaInst* AI){
+   return starts[AI];
+}
+
+const std::vector<IntrinsicInst*>& LifetimeMarkers::getEnds(AllocaInst* AI){
+   return ends[AI];
+}
+
+/**
+ * @function isUsedOutside:
+ * @returns true if the address V (inside AI) is used where AI is not alive
+ **/
+bool LifetimeMarkers::isUsedOutside(Value* V, AllocaInst* AI){
+   for(User* U : V->users()){
+      Instruction* I = dyn_cast<Instruction>(U);
+      Intrinsic::ID ID;
+      if(I == nullptr || getMarkedVariable(I, ID) != nullptr){
+	 continue;
+      }
+      if(isa<BitCastInst>(I) || isa<GetElementPtrInst>(I)){
+	 if(isUsedOutside(I, AI)){
+	    return true;
+	 }
+      }
+      else if(!isAlive(AI, I)){
+	 return true;
+      }
+   }
+   return false;
+}
+
+/**
+ * @function estimateFrameSize:
+ * estimates the stack frame of F once StackColoring shares the slots: the largest amount of bytes alive at the same time
+ * for the variables used only between their markers, plus all the other variables
+ * @param F the current function (compute must have been called)
+ * @returns the size in bytes
+ **/
+uint64_t LifetimeMarkers::estimateFrameSize(Function& F){
+   const DataLayout &DL = F.getParent()->getDataLayout();
+   uint64_t always = 0;
+   std::map<AllocaInst*, uint64_t> colored;
+   for(Instruction &I : F.front()){
+      AllocaInst* AI = dyn_cast<AllocaInst>(&I);
+      if(AI == nullptr || !AI->isStaticAlloca()){
+	 continue;
+      }
+      uint64_t size = DL.getTypeAllocSize(AI->getAllocatedType());
+      if(ConstantInt* count = dyn_cast<ConstantInt>(AI->getArraySize())){
+	 size *= count->getZExtValue();
+      }
+      if(hasMarkers(AI) && !isUsedOutside(AI, AI)){
+	 colored[AI] = size;
+      }
+      else{
+	 always += size;
+      }
+   }
+   uint64_t largest = 0;
+   for(BasicBlock &BB : F){
+      Variables alive = aliveIn[&BB];
+      Variables started = startedIn[&BB];
+      for(Instruction &I : BB){
+	 transfer(&I, alive, started);
+	 uint64_t bytes = 0;
+	 for(AllocaInst* AI : alive){
+	    bytes += colored.count(AI) ? colored[AI] : 0;
+	 }
+	 largest = std::max(largest, bytes);
+      }
+   }
+   return always + largest;
+}
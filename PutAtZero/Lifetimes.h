@@ -0,0 +1,35 @@
+#ifndef LIFETIMES_H
+#define LIFETIMES_H
+
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include <map>
+#include <set>
+#include <vector>
+
+//the variables between llvm.lifetime.start and llvm.lifetime.end
+//the code generator (StackColoring) gives the same stack slot to variables which are never alive at the same time,
+//unless one of them is accessed out of its markers
+class LifetimeMarkers{
+ public:
+   void compute(llvm::Function& F);
+   bool hasMarkers(llvm::AllocaInst* AI);
+   bool isAlive(llvm::AllocaInst* AI, llvm::Instruction* I);
+   bool isStarted(llvm::AllocaInst* AI, llvm::Instruction* I);
+   const std::vector<llvm::IntrinsicInst*>& getStarts(llvm::AllocaInst* AI);
+   const std::vector<llvm::IntrinsicInst*>& getEnds(llvm::AllocaInst* AI);
+   uint64_t estimateFrameSize(llvm::Function& F);
+
+ private:
+   typedef std::set<llvm::AllocaInst*> Variables;
+   std::map<llvm::AllocaInst*, std::vector<llvm::IntrinsicInst*>> starts;
+   std::map<llvm::AllocaInst*, std::vector<llvm::IntrinsicInst*>> ends;
+   std::map<const llvm::BasicBlock*, Variables> aliveIn;//may be alive at the beginning of the block
+   std::map<const llvm::BasicBlock*, Variables> startedIn;//may have been started before the block
+
+   void transfer(llvm::Instruction* I, Variables& alive, Variables& started);
+   bool isUsedOutside(llvm::Value* V, llvm::AllocaInst* AI);
+};
+
+#endif
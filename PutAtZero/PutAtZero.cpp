@@ -30,21 +30,243 @@
 #include "llvm/IR/Instruction.h"
 #include "llvm/Analysis/LoopInfoImpl.h"
 #include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/CFG.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/PostOrderIterator.h"
 #include "llvm/Analysis/PostDominators.h"
+#include "llvm/Analysis/AssumptionCache.h"
+#include "llvm/Analysis/BlockFrequencyInfo.h"
+#include "llvm/Analysis/BranchProbabilityInfo.h"
+#include "llvm/Analysis/MemoryBuiltins.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include "llvm/Transforms/Utils/CodeExtractor.h"
+#include "llvm/Transforms/Utils/Local.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <set>
 #include <utility>
 #include "PutAtZero.h"
+#include "CallCompat.h"
+#include "CalleeSummary.h"
+#include "PhaseTimer.h"
+#include "PlacementPlan.h"
+#include "RuntimeSupport.h"
+#include "ScrubMetadata.h"
+#include "ScrubCounters.h"
+#include "ScrubVerifier.h"
+#include "SensitiveGlobals.h"
+#include "StackLeak.h"
+#include "Lifetimes.h"
 
 using namespace llvm;
 
+#define DEBUG_TYPE "putatzero"
+#if LLVM_VERSION_MAJOR < 7
+#define LLVM_DEBUG(X) DEBUG(X)
+#endif
+
+static cl::opt<bool> PaZOptimized("paz-optimized", cl::desc("PutAtZero runs late in an optimized pipeline (-O2): the return blocks are merged and the sensitive values promoted to registers are put back in memory"), cl::init(false));
+
+static cl::list<std::string> PaZSensitive("paz-sensitive", cl::desc("names of the sensitive source variables to keep in memory when they were promoted to registers, and of the sensitive global variables"), cl::CommaSeparated);
+
+static cl::opt<bool> PaZOutlineCold("paz-outline-cold", cl::desc("the STORE 0 shared by the unreachable and resume exits are moved in a cold function"), cl::init(true));
+
+static cl::opt<bool> PaZEstimate("paz-estimate", cl::desc("analysis only: estimates the number of STORE 0 executed by each function without modifying the code"), cl::init(false));
+
+static cl::opt<bool> PaZCount("paz-count", cl::desc("counts the STORE 0 executed at runtime (link with ScrubRuntime/libPaZRuntime.a)"), cl::init(false));
+
+static cl::opt<bool> PaZVerify("paz-verify", cl::desc("verification build: the bytes written and not set to 0 when the function exits are reported at runtime (link with ScrubRuntime/libPaZRuntime.a)"), cl::init(false));
+
+static cl::opt<bool> PaZQuiet("paz-quiet", cl::desc("the statistics are not displayed after each module (paz-batch displays them once for all its modules)"), cl::init(false));
+
+static cl::list<std::string> PaZSkip("paz-skip", cl::desc("names of the functions left untouched by PutAtZero"), cl::CommaSeparated);
+
+static cl::opt<std::string> PaZTier("paz-tier", cl::desc("default placement of the STORE 0, overridden by the paz.tier metadata, the \"paz-tier\" attribute or the paz_tier=<tier> annotation of a function: exit (each variable once, at the exits), balanced (after the last use, never inside a loop) or paranoid (after the last use)"), cl::init("paranoid"));
+
+static cl::opt<bool> PaZEdges("paz-edges", cl::desc("edge-precise placement: the STORE 0 are put on the CFG edges where the variable dies (critical edges split), not at the front of the first dominator block after its last use"), cl::init(false));
+
+static cl::opt<uint64_t> PaZBudget("paz-budget", cl::desc("maximal number of blocks x variables of a function placed after the last uses; the bigger functions are set to 0 at the exits only (0: no limit)"), cl::init(4000000));
+
+static cl::opt<bool> PaZStackLeak("paz-stackleak", cl::desc("the functions below the entry points only update a stack high-water mark, the stack they used is wiped at once when the entry point returns (link with ScrubRuntime/libPaZRuntime.a)"), cl::init(false));
+
+static cl::opt<uint64_t> PaZStackLeakSlack("paz-stackleak-slack", cl::desc("bytes wiped below the lowest stack address recorded by -paz-stackleak, for the uninstrumented functions (libc...) called by the deepest one"), cl::init(256));
+
+static cl::list<std::string> PaZEntry("paz-entry", cl::desc("names of the entry points of -paz-stackleak, besides the functions annotated with paz_entry or with the \"paz-entry\" attribute"), cl::CommaSeparated);
+
+static cl::list<std::string> PaZSwitchable("paz-switchable", cl::desc("names of the functions cloned in a scrubbed and a plain version, chosen at runtime by __paz_scrub_enabled (PAZ_SCRUB=0 or __paz_set_scrubbing), besides the functions annotated with paz_switchable or with the \"paz-switchable\" attribute"), cl::CommaSeparated);
+
+static cl::opt<bool> PaZQuarantine("paz-quarantine", cl::desc("the calls to free are redirected to __paz_free: the buffers are set to 0 before being freed, the large ones by a background thread (link with ScrubRuntime/libPaZRuntime.a)"), cl::init(false));
+
+static cl::opt<std::string> PaZPlanExport("paz-plan-export", cl::desc("writes the placement plan of the STORE 0 in this file (JSON, one STORE 0 per line)"), cl::init(""));
+
+static cl::opt<std::string> PaZPlanImport("paz-plan-import", cl::desc("applies the placement plan of this file (written by -paz-plan-export) instead of running the analysis on the functions it covers (LLVM 7 and later)"), cl::init(""));
+
+static cl::opt<bool> PaZDryRun("paz-dry-run", cl::desc("analysis only: the placement plan is computed on a copy of each function and written (-paz-plan-export, or stderr), the module is not modified"), cl::init(false));
+
+static cl::opt<uint64_t> PaZMaxSteps("paz-max-steps", cl::desc("maximal number of blocks visited by the last use analysis of a function before it falls back to the exits only (0: no limit)"), cl::init(1000000));
+
 namespace {
+ thread_local bool onCopy = false;//the STORE 0 are added to a copy of the function (-paz-estimate): they are neither counted nor displayed
+
+ //a counter of the statistics, shared by the threads of paz-batch: what happens to a copy is not counted
+ template<typename T> class ScrubStatistic{
+  public:
+   ScrubStatistic(T value) : value(value) {}
+   void operator++(int){
+      if(!onCopy){
+	 value++;
+      }
+   }
+   void operator+=(T n){
+      if(!onCopy){
+	 value += n;
+      }
+   }
+   operator T() const{
+      return value;
+   }
+
+  private:
+   std::atomic<T> value;
+ };
+
+ //the analysis of a copy, until the end of the scope
+ struct CopyScope{
+   CopyScope(){
+      onCopy = true;
+   }
+   ~CopyScope(){
+      onCopy = false;
+   }
+ };
+
+ struct FunctionEstimate{
+   std::string name;
+   unsigned points;//the number of STORE 0 which would be added
+   double stores;//the estimated number of STORE 0 executed for a call to the function
+   double bytes;//the estimated number of bytes they set to 0
+ };
+
+ enum ScrubTier{exitTier, balancedTier, paranoidTier};
+ //exit     -> every variable is set to 0 once, before the returns and in the dead ends: the cheapest, the values stay in memory until the function exits
+ //balanced -> the STORE 0 are placed after the last use, but the ones falling in a loop are moved at its exits (or at the returns)
+ //paranoid -> the STORE 0 are placed after the last use, even if it is executed at each iteration
+
  struct PutAtZero : public FunctionPass {
 
    static char ID;
-   static int numSTORE0ADDED;//The number of instruction STORE 0 added
+   static ScrubStatistic<int> numSTORE0ADDED;//The number of instruction STORE 0 added
+   static ScrubStatistic<int> numSTORE0REMOVED;//The number of duplicate STORE 0 removed (inlined functions already handled)
+   static ScrubStatistic<int> numDEMOTED;//The number of sensitive values put back from registers to memory
+   static ScrubStatistic<int> numCOLDEXITS;//The number of unreachable/resume exits going through a shared cold block
+   static ScrubStatistic<int> numSENSITIVEGLOBALS;//The number of global variables moved in the sensitive section
+   static ScrubStatistic<int> numCOROFRAMES;//The number of coroutine frames set to 0 when they are destroyed
+   static ScrubStatistic<int> numLIFETIMEMOVED;//The number of STORE 0 moved between the lifetime markers of their variable
+   static ScrubStatistic<int> numEXITTIER;//The number of functions handled with the exit tier
+   static ScrubStatistic<int> numBALANCEDTIER;//The number of functions handled with the balanced tier
+   static ScrubStatistic<int> numLOOPHOISTED;//The number of STORE 0 moved out of a loop (balanced tier)
+   static ScrubStatistic<int> numSPLITEDGES;//The number of critical edges split to receive a STORE 0 (-paz-edges)
+   static ScrubStatistic<int> numPROGRAMSCRUBS;//The number of memset to 0 of the program kept (made volatile) instead of adding a STORE 0
+   static ScrubStatistic<int> numOVERBUDGET;//The number of functions set to 0 at the exits only because of -paz-budget or -paz-max-steps
+   static ScrubStatistic<int> numSTACKENTRIES;//The number of entry points wiping the stack below them (-paz-stackleak)
+   static ScrubStatistic<int> numSTACKTRACKED;//The number of functions only updating the stack high-water mark (-paz-stackleak)
+   static ScrubStatistic<int> numSWITCHABLE;//The number of functions dispatching between their scrubbed and their plain version (-paz-switchable)
+   static ScrubStatistic<int> numPLANNED;//The number of functions whose STORE 0 were placed from an imported plan (-paz-plan-import)
+   static ScrubStatistic<int> numQUARANTINED;//The number of uses of free redirected to __paz_free (-paz-quarantine)
+   static ScrubStatistic<uint64_t> numFRAMEBEFORE;//The estimated size of the stack frames before the pass (StackColoring applied)
+   static ScrubStatistic<uint64_t> numFRAMEAFTER;//The same estimation once the STORE 0 are added
+
+   CalleeSummaries summaries;//what each function does with the pointers it is given
+   ScrubCounters counters;//-paz-count
+   ScrubVerifier verifier;//-paz-verify
+   StackLeak stackleak;//-paz-stackleak
+   Function* lastFunction;//the last function handled, -paz-count
+   std::vector<AllocaInst*> escaped;//the variables whose address is kept by a callee: only set to 0 at the exits
+   std::vector<Instruction*> scrubs;//the STORE 0 added to the current function
+   std::vector<Instruction*> programScrubs;//the memsets of the program kept in place of a STORE 0, never moved nor erased
+   ScrubPlan plan;//the STORE 0 of the current function, all decided by the analysis before the first one is added (apply)
+   std::vector<BasicBlock*> deadEnds;//the dead ends going through the block of the STORE 0 planned in them
+   std::set<std::pair<BasicBlock*, BasicBlock*>> splitEdges;//the critical edges which receive a block for their STORE 0, -paz-edges
+   std::set<Function*> coldFunctions;//the functions made by outline_cold: their STORE 0 are in the plan of their caller
+   std::vector<AllocaInst*> slots;//the variables of the current function which are set to 0, -paz-verify
+   std::vector<FunctionEstimate> estimates;//with -paz-estimate, the estimation of each function
+   LoopInfo* loopInfo;//the loops of the function being handled
+   LifetimeMarkers lifetimes;//where the variables with llvm.lifetime markers are alive
+   ScrubTier tier;//the placement used for the current function
+   uint64_t steps;//the blocks visited by the last use analysis of the current function, -paz-max-steps
+   std::map<const Function*, std::string> annotatedTiers;//the functions with the annotation paz_tier=<tier>
+   std::map<Function*, Function*> plainClones;//the switchable functions and their copy without STORE 0, -paz-switchable
+   std::pair<Function*, Function*> quarantinedFree;//free and __paz_free, -paz-quarantine
+   StringRef reason;//the step of the placement running, written in the plan (then in the !storm.scrub metadata) of the STORE 0 it decides
+   std::vector<PlannedScrub> exportedPlan;//the plan of the functions handled so far, -paz-plan-export and -paz-dry-run
+   std::map<std::pair<std::string, std::string>, std::vector<PlannedScrub>> importedPlans;//the plan of each function by module and name, -paz-plan-import
+   PhaseTimers timers;//-time-passes, -ftime-trace
+
+   PutAtZero() : FunctionPass(ID), lastFunction(nullptr), loopInfo(nullptr), tier(paranoidTier), steps(0), quarantinedFree(nullptr, nullptr), timers("PutAtZero") {} //we're building a new pass
 
-   PutAtZero() : FunctionPass(ID) {} //we're building a new pass
+   /**
+    * @function doInitialization override:
+    * computes the summaries of all the functions of the module before handling them one by one
+    * and gathers the sensitive global variables in their section
+    * @param M the current module
+    * @returns true if the module was modified (sensitive globals, counters of -paz-count, plain clones of -paz-switchable, calls to free of -paz-quarantine)
+    **/
+   bool doInitialization(Module &M) override{
+      summaries.compute(M);
+      annotatedTiers.clear();
+      for(auto &annotation : getGlobalAnnotations(M)){
+	 StringRef text(annotation.second);
+	 if(isa<Function>(annotation.first) && text.startswith("paz_tier=")){
+	    annotatedTiers[cast<Function>(annotation.first)] = text.substr(strlen("paz_tier=")).str();
+	 }
+      }
+      exportedPlan.clear();
+      importedPlans.clear();
+      coldFunctions.clear();
+      if(!PaZPlanImport.empty()){
+	 import_plan();
+      }
+      if(PaZEstimate || PaZDryRun){
+	 return false;
+      }
+      int moved = moveSensitiveGlobals(M, std::vector<std::string>(PaZSensitive.begin(), PaZSensitive.end()));
+      numSENSITIVEGLOBALS += moved;
+      if(PaZVerify){
+	 verifier.initialize(M);
+      }
+      if(PaZStackLeak){
+	 stackleak.initialize(M, std::vector<std::string>(PaZEntry.begin(), PaZEntry.end()), PaZStackLeakSlack);
+	 if(stackleak.getNumEntries() == 0){
+	    errs() << "\033[0;31m-paz-stackleak: no entry point in " << M.getModuleIdentifier() << " (paz_entry, \"paz-entry\", -paz-entry), the stack is never wiped\033[0;0m\n";
+	 }
+      }
+      clone_switchable(M);
+      int quarantined = PaZQuarantine ? quarantine_frees(M) : 0;//counted in each function, once it is read (paz-batch -lazy)
+      if(PaZCount){
+	 counters.initialize(M);
+	 for(Function &F : M){
+	    if(!F.isDeclaration()){
+	       lastFunction = &F;
+	    }
+	 }
+	 return true;
+      }
+      return moved > 0 || PaZVerify || (PaZStackLeak && stackleak.getNumEntries() > 0) || !plainClones.empty() || quarantined > 0;
+   }
 
    /**
     * @function runOnFunction override:
@@ -55,17 +277,184 @@ namespace {
     *
     **/
    bool runOnFunction(Function &F) override {
+      bool modified = false;
+      if(quarantinedFree.first != nullptr){
+	 if(!quarantinedFree.first->use_empty()){//F was read from the bitcode after doInitialization (paz-batch -lazy)
+	    quarantinedFree.first->replaceAllUsesWith(quarantinedFree.second);
+	    modified = true;
+	 }
+	 numQUARANTINED += countUses(F, quarantinedFree.second);
+      }
+      //the cold functions are added at the end of the module while their caller is handled: their STORE 0 were placed, counted and verified there
+      bool skipped = std::find(PaZSkip.begin(), PaZSkip.end(), F.getName().str()) != PaZSkip.end() || isPlainClone(F) || coldFunctions.count(&F);
+      tier = getTier(F);
+      if(!skipped && tier == exitTier){
+	 numEXITTIER++;
+      }
+      else if(!skipped && tier == balancedTier){
+	 numBALANCEDTIER++;
+      }
+      if(!skipped && PaZEstimate){
+	 estimate(F);
+      }
+      else if(!skipped && PaZDryRun){
+	 dry_run(F);
+      }
+      else if(!skipped && PaZStackLeak && stackleak.isTracked(F)){//its frame is wiped with the others when the entry point returns
+	 PhaseScope phase(timers, "stackleak", F);
+	 stackleak.track(F);
+	 numSTACKTRACKED++;
+	 modified = true;
+      }
+      else if(!skipped){
+	 scrubs.clear();
+	 programScrubs.clear();
+	 loopInfo = &getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
+	 DominatorTree &DT = getAnalysis<DominatorTreeWrapperPass>().getDomTree();
+	 prepare(F, *loopInfo, DT);
+	 slots = getSlots(F);//whichever gives the plan, it is applied to these variables
+	 uint64_t frame = lifetimes.estimateFrameSize(F);
+	 auto imported = importedPlans.find(std::make_pair(F.getParent()->getModuleIdentifier(), F.getName().str()));
+	 if(imported == importedPlans.end()){//a plan written without the modules
+	    imported = importedPlans.find(std::make_pair(std::string(), F.getName().str()));
+	 }
+	 if(imported != importedPlans.end() && replay_plan(F, imported->second)){
+	    numPLANNED++;
+	    modified = true;
+	 }
+	 else{
+	    modified = place(F, *loopInfo, DT);
+	 }
+	 if(!PaZPlanExport.empty()){//the plan refers to the code the analysis saw, before the STORE 0 are added
+	    std::vector<PlannedScrub> placed = getPlannedScrubs(F, F.getName(), plan);
+	    exportedPlan.insert(exportedPlan.end(), placed.begin(), placed.end());
+	 }
+	 apply(F, *loopInfo, DT);
+	 if(modified){
+	    lifetimes.compute(F);
+	    numFRAMEBEFORE += frame;
+	    numFRAMEAFTER += lifetimes.estimateFrameSize(F);
+	 }
+	 std::vector<Instruction*> sites(scrubs);
+	 sites.insert(sites.end(), programScrubs.begin(), programScrubs.end());
+	 if(PaZCount){
+	    PhaseScope phase(timers, "count", F);
+	    counters.instrument(F, sites);
+	 }
+	 if(PaZVerify){
+	    PhaseScope phase(timers, "verify", F);
+	    verifier.instrument(F, slots, sites);
+	 }
+	 if(PaZStackLeak && stackleak.isEntry(F)){
+	    PhaseScope phase(timers, "stackleak", F);
+	    stackleak.instrumentEntry(F);
+	    numSTACKENTRIES++;
+	 }
+	 auto plain = plainClones.find(&F);
+	 if(plain != plainClones.end()){
+	    add_dispatch(F, plain->second);
+	 }
+      }
+      //the module is printed before doFinalization is called, the descriptor of the counters is filled after the last function
+      if(PaZCount && !PaZEstimate && &F == lastFunction){
+	 counters.finalize(*F.getParent());
+	 modified = true;
+      }
+      return modified;
+   }
 
-      initialize(F);
+   /**
+    * @function prepare:
+    * the changes made to a function before its STORE 0 are placed, by the analysis or by an imported plan:
+    * with -paz-optimized, the sensitive values are put back in memory and the returns merged
+    * @param F the function
+    * @param loopData the loops of F, kept up to date
+    * @param DT the dominator tree of F, kept up to date
+    * @returns nothing
+    *
+    **/
+   void prepare(Function &F, LoopInfo& loopData, DominatorTree& DT){
+      if(PaZOptimized){
+	 PhaseScope phase(timers, "demote_sensitive", F);
+	 demote_sensitive(F);
+	 if(unify_returns(F)){//the CFG changed, the analysis are outdated
+	    DT.recalculate(F);
+	    loopData.releaseMemory();
+	    loopData.analyze(DT);
+	 }
+      }
+      lifetimes.compute(F);//after the demotion: the slots it adds are the price of -paz-optimized, not of the placement
+   }
 
-      LoopInfo& loopData = getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
-      DominatorTree& DT = getAnalysis<DominatorTreeWrapperPass>().getDomTree();
+   /**
+    * @function getSlots:
+    * @param F the function
+    * @returns the variables of its first block which are set to 0 as a whole (the dynamic arrays apart)
+    **/
+   std::vector<AllocaInst*> getSlots(Function &F){
+      std::vector<AllocaInst*> variables;
+      for(Instruction &I : F.front()){
+	 AllocaInst* AI = dyn_cast<AllocaInst>(&I);
+	 if(AI != nullptr && !isDynamicArray(AI)){
+	    variables.push_back(AI);
+	 }
+      }
+      return variables;
+   }
+
+   /**
+    * @function start_plan:
+    * empties the plan before the STORE 0 of a function are decided
+    * @param F the function
+    * @returns nothing
+    **/
+   void start_plan(Function &F){
+      plan.clear();
+      deadEnds.clear();
+      splitEdges.clear();
+      std::vector<ReturnInst*> returns;
+      for(BasicBlock &BB : F){
+	 if(ReturnInst* RI = dyn_cast<ReturnInst>(BB.getTerminator())){
+	    returns.push_back(RI);
+	 }
+      }
+      if(returns.size() == 1){//nothing is merged: the STORE 0 of the returns follow the ones already before it
+	 plan.setReturn(returns[0]);
+      }
+   }
+
+   /**
+    * @function place:
+    * the analysis: decides where the STORE 0 instructions of a function go, without adding any (see apply)
+    * @param F the function, prepared
+    * @param loopData the loops of F
+    * @param DT the dominator tree of F
+    * @returns false if the function cannot be handled, true elsewhere
+    *
+    **/
+   bool place(Function &F, LoopInfo& loopData, DominatorTree& DT){
+      start_plan(F);
+
+      if(tier != exitTier && PaZBudget > 0 && (uint64_t)F.size() * slots.size() > PaZBudget){
+	 errs() << "\033[0;31m" << F.getName() << ": " << F.size() << " blocks x " << slots.size() << " variables over -paz-budget, set to 0 at the exits only\033[0;0m\n";
+	 numOVERBUDGET++;
+	 tier = exitTier;
+      }
+      if(tier == exitTier){
+	 place_at_exits(F, DT);
+	 return true;
+      }
+      steps = 0;
+
+      PhaseScope init(timers, "initialize", F);
+      initialize(F);
+      find_escaped(F);
+      init.stop();
 
-      BlockList blockList;//The blocks with their colors
-      InstructionList iList;//The variables and their booleans (dead or not) for each block
       std::vector<BasicBlock*> dominator_blocks;//the dominator blocks: the blocks you are forced to go through in order to reach the exit
-      std::vector<BasicBlock*> deadEndBlocks;//the eventually dead end blocks (assert fail, exit values...)
+      std::vector<BasicBlock*> deadEndBlocks;//the eventually dead end blocks (assert fail, exit values, exceptions going out...)
 
+      PhaseScope chain(timers, "dominator chain", F);
       BasicBlock* BB = &F.back();//the last block
       dominator_blocks.push_back(BB);//obviously, the last block is visited since it contains the return instruction (even in void functions)
 
@@ -109,12 +498,11 @@ namespace {
 	 }
 	 else{
    	    auto it = pred_begin(BB), it_end = pred_end(BB);//if there are several predecessors, we iterate over them
-	    if(it != it_end){//special case for dead ends
-   	       B_new = *it;
-	    }
    	    while(it != it_end){
-	       B_new = DT.findNearestCommonDominator(B_new, *it);
-	       //we get the block which dominates both the current one (*it) and the "new one" (B_new) in order to make sure that B_new dominates all the predecessors of BB
+	       if(DT.isReachableFromEntry(*it)){//the blocks without predecessor left after a noreturn call (assert fail) are not in the dominator tree
+		  B_new = B_new == nullptr ? *it : DT.findNearestCommonDominator(B_new, *it);
+		  //we get the block which dominates both the current one (*it) and the "new one" (B_new) in order to make sure that B_new dominates all the predecessors of BB
+	       }
 	       it++;
 	    }
 	    if(B_new != nullptr && loopData.getLoopFor(B_new) == nullptr){
@@ -124,13 +512,66 @@ namespace {
 	 }
       }
 
-      for(BasicBlock &BB : F){//we put all the blocks to white since there is no block treated
-	 if(isDeadEnd(&BB)){//if the block is a dead end, we add it to our deadEnd vector
+      chain.stop();
+
+      for(BasicBlock &BB : F){
+	 if(isDeadEnd(&BB) || isa<ResumeInst>(BB.getTerminator())){//if the block is a dead end, we add it to our deadEnd vector
 	    deadEndBlocks.push_back(&BB);
-	 } 
+	 }
+      }
+      if(PaZEdges){
+	 PhaseScope edges(timers, "place_on_edges", F);
+	 place_on_edges(F, loopData, DT);
+      }
+      else if(!walk_back(F, loopData, DT, dominator_blocks)){
+	 return false;
+      }
+
+      if(isOverSteps()){//what was placed so far is dropped: the exit tier does not depend on it
+	 errs() << "\033[0;31m" << F.getName() << ": more than " << PaZMaxSteps << " steps (-paz-max-steps), set to 0 at the exits only\033[0;0m\n";
+	 numOVERBUDGET++;
+	 for(unsigned i = 0; i < plan.size(); ++i){
+	    if(plan[i].site != programMemSet){
+	       plan.drop(i);
+	    }
+	 }
+	 place_at_exits(F, DT);
+	 return true;
+      }
+
+      array_handler(F, dominator_blocks, DT);//then we handle the arrays
+      if(tier == balancedTier){
+	 PhaseScope hoist(timers, "hoist_loop_scrubs", F);
+	 hoist_loop_scrubs(F, loopData);
+      }
+      kill_dynamic_arrays(F, DT);//and the arrays whose size is only known at runtime
+      kill_unreachables(deadEndBlocks, F);//end we had a 0 setting in the deadEndBlocks
+      finish(F);
+      return true;
+   }
+
+   /**
+    * @function walk_back:
+    * the last use analysis: walks back from the return block, the loops being handled by loop_handler,
+    * and adds the STORE 0 after the last use of each variable or at the front of the first dominator block after it
+    * @param F the current function
+    * @param loopData the loops of F
+    * @param DT the dominator tree of F
+    * @param dominator_blocks the dominator blocks, from the return block up
+    * @returns false if the function cannot be handled (a loop header at the end)
+    *
+    **/
+   bool walk_back(Function &F, LoopInfo& loopData, DominatorTree& DT, std::vector<BasicBlock*>& dominator_blocks){
+      reason = "last use";
+      BlockList blockList;//The blocks with their colors
+      InstructionList iList;//The variables and their booleans (dead or not) for each block
+
+      PhaseScope worklist(timers, "worklist", F);
+      for(BasicBlock &BB : F){//we put all the blocks to white since there is no block treated
 	 blockList[&BB] = white;
       }
 
+      std::set<BasicBlock*> returning = getReturning(F);//the others only lead to dead ends (landing pads, assert fails...)
       std::list<BasicBlock*> toTreat;
       // We will have to visit all the blocks from the return one to the first one.
       // We cannot iterate easily over them since some of them will be visited several times (each block with more than one successor is visited after each successor so at least twice)
@@ -143,7 +584,7 @@ namespace {
       }
 
 
-      while(!toTreat.empty()){//while there is an untreated block,
+      while(!toTreat.empty() && spend()){//while there is an untreated block,
 
 	 BasicBlock* header = toTreat.front();
 	 Instruction* I = header->getTerminator();
@@ -164,7 +605,7 @@ namespace {
 	 else{
 	    //if there is a successor untreated which is not a dead end, we have to make sure it is correctly handled so we put it at the end of the vector to treat it only once every single successor was handled
 	    for(auto itBlock = succ_begin(header), itBlock_end = succ_end(header); itBlock != itBlock_end; itBlock++){
-	       if(blockList[*itBlock] == white && !isDeadEnd(*itBlock)){
+	       if(blockList[*itBlock] == white && returning.count(*itBlock)){
 		  toTreat.push_back(header);
 		  I = nullptr;
 		  break;
@@ -184,131 +625,2103 @@ namespace {
 	 }
 	 toTreat.pop_front();
       }//end while
-
-
-      array_handler(F, dominator_blocks, DT);//then we handle the arrays
-      kill_unreachables(deadEndBlocks, F);//end we had a 0 setting in the deadEndBlocks
-      
-      
-      
       return true;
    }
 
    /**
-    * @function isDeadEnd:
-    * is the given block a dead end?
-    * @param BasicBlock* BB the block to test
-    * @returns true if the block contains an unreachable instruction ---> is a dead end (no successor but not a normal exit either)
-    * false elsewhere
+    * @function place_on_edges:
+    * -paz-edges: a backward liveness of the variables handled by the last use analysis (getAccesses).
+    * A variable is set to 0 right after an access when it is not alive after it, and on each edge B -> S
+    * where it is alive at the end of B but not at the beginning of S: at the front of S when B is its only predecessor,
+    * in a new block on the edge otherwise (critical edge, split when the plan is applied). The paths where the variable was already dead do not execute any STORE 0.
+    * @param F the current function
+    * @param loopData the loops of F
+    * @param DT the dominator tree of F
+    * @returns nothing
     *
     **/
-   bool isDeadEnd(BasicBlock* BB){
-      Instruction* I = BB->getTerminator();//for all the instructions in the block
-      while(I != nullptr){
-	 if(UnreachableInst* CI = dyn_cast<UnreachableInst>(I)){//if I is an unreachable instruction
-	    return true;//the block is a dead end
+   void place_on_edges(Function &F, LoopInfo& loopData, DominatorTree& DT){
+      std::map<AllocaInst*, unsigned> index;
+      std::vector<AllocaInst*> variables;
+      std::map<BasicBlock*, std::vector<std::pair<PlannedCode, std::vector<std::pair<AllocaInst*, bool>>>>> accesses;
+      for(BasicBlock &BB : F){
+	 for(PlannedCode I : plan.getCode(&BB)){//the STORE 0 of initialize included
+	    std::vector<std::pair<AllocaInst*, bool>> used = getAccesses(I);
+	    if(used.empty()){
+	       continue;
+	    }
+	    for(auto access : used){
+	       if(!index.count(access.first)){
+		  index[access.first] = variables.size();
+		  variables.push_back(access.first);
+	       }
+	    }
+	    accesses[&BB].push_back(std::make_pair(I, used));
+	 }
+      }
+      if(variables.empty()){
+	 return;
+      }
+
+      std::map<BasicBlock*, BitVector> used, killed, liveIn, liveOut;//used: read before being overwritten in the block
+      for(BasicBlock &BB : F){
+	 used[&BB] = BitVector(variables.size());
+	 killed[&BB] = BitVector(variables.size());
+	 liveIn[&BB] = BitVector(variables.size());
+	 liveOut[&BB] = BitVector(variables.size());
+	 auto &list = accesses[&BB];
+	 for(auto it = list.rbegin(), end = list.rend(); it != end; ++it){//backward: the first access of the block decides
+	    for(auto access : it->second){
+	       unsigned i = index[access.first];
+	       if(access.second){
+		  used[&BB].set(i);
+		  killed[&BB].reset(i);
+	       }
+	       else{
+		  killed[&BB].set(i);
+		  used[&BB].reset(i);
+	       }
+	    }
+	 }
+      }
+      bool changed = true;
+      while(changed && spend()){
+	 changed = false;
+	 for(BasicBlock* BB : post_order(&F.getEntryBlock())){//the successors first
+	    BitVector out(variables.size());
+	    for(auto it = succ_begin(BB), end = succ_end(BB); it != end; ++it){
+	       out |= liveIn[*it];
+	    }
+	    BitVector in(out);
+	    in.reset(killed[BB]);
+	    in |= used[BB];
+	    if(in != liveIn[BB] || out != liveOut[BB]){
+	       liveIn[BB] = in;
+	       liveOut[BB] = out;
+	       changed = true;
+	    }
+	 }
+      }
+      if(isOverSteps()){
+	 return;
+      }
+
+      std::vector<std::pair<PlannedCode, AllocaInst*>> afterAccess;//the STORE 0 right after the last access
+      std::vector<std::pair<std::pair<BasicBlock*, BasicBlock*>, AllocaInst*>> onEdge;//the STORE 0 on an edge where the variable dies
+      for(BasicBlock* BB : post_order(&F.getEntryBlock())){
+	 BitVector live(liveOut[BB]);
+	 auto &list = accesses[BB];
+	 for(auto it = list.rbegin(), end = list.rend(); it != end; ++it){
+	    PlannedCode I = it->first;
+	    for(auto access : it->second){
+	       unsigned i = index[access.first];
+	       if(!live.test(i) && !isAStore0Inst(I)){//dead after I: the last access on this path
+		  afterAccess.push_back(std::make_pair(I, access.first));
+		  live.set(i);//a variable accessed twice by I (memcpy from itself) is set to 0 once
+	       }
+	    }
+	    for(auto access : it->second){
+	       unsigned i = index[access.first];
+	       if(access.second){
+		  live.set(i);
+	       }
+	       else{
+		  live.reset(i);
+	       }
+	    }
+	 }
+	 std::vector<BasicBlock*> successors;
+	 for(auto it = succ_begin(BB), end = succ_end(BB); it != end; ++it){
+	    if(std::find(successors.begin(), successors.end(), *it) != successors.end()){
+	       continue;
+	    }
+	    successors.push_back(*it);
+	    BitVector dying(liveOut[BB]);
+	    dying.reset(liveIn[*it]);
+	    for(int i = dying.find_first(); i != -1; i = dying.find_next(i)){
+	       onEdge.push_back(std::make_pair(std::make_pair(BB, *it), variables[i]));
+	    }
+	 }
+      }
+
+      reason = "last use";
+      for(auto &scrub : afterAccess){
+	 MemSetInst* MSI = scrub.first.isScrub() ? nullptr : getZeroingMemSet(scrub.first.instruction, scrub.second);
+	 if(MSI != nullptr){//the program sets the variable to 0 itself
+	    keep_program_scrub(MSI, scrub.second);
+	 }
+	 else{
+	    planStore0(scrub.first, scrub.second);
+	 }
+      }
+      reason = "edge";
+      for(auto &scrub : onEdge){
+	 BasicBlock* from = scrub.first.first;
+	 BasicBlock* to = scrub.first.second;
+	 if(to->getSinglePredecessor() == nullptr && (splitEdges.count(scrub.first) || isSplittable(from, to))){
+	    splitEdges.insert(scrub.first);
+	    planOnEdge(scrub.second, from, to);
+	 }
+	 //when the edge cannot be split (exception edges, indirectbr), the variable is not alive at the beginning of the successor: it is set to 0 there
+	 else if(to->getFirstInsertionPt() != to->end()){
+	    planStore0(PlannedCode(scrub.second), scrub.second, getFirstInsertionCode(to));
+	 }
+      }
+   }
+
+   /**
+    * @function isSplittable:
+    * @param from a block
+    * @param to one of its successors, which has other predecessors
+    * @returns true if splitEdge gives a new block on the edge from -> to (a critical edge, neither from an indirectbr nor to an exception pad)
+    **/
+   bool isSplittable(BasicBlock* from, BasicBlock* to){
+#if LLVM_VERSION_MAJOR >= 8
+      Instruction* TI = from->getTerminator();
+#else
+      TerminatorInst* TI = from->getTerminator();
+#endif
+      if(isa<IndirectBrInst>(TI) || to->isEHPad()){
+	 return false;
+      }
+      for(unsigned i = 0; i < TI->getNumSuccessors(); ++i){
+	 if(TI->getSuccessor(i) == to){
+	    return isCriticalEdge(TI, i, true);
 	 }
-	 I = I->getPrevNode();
       }
       return false;
    }
 
    /**
-    * @function getFirstDom:
-    * returns the first dominator block (according to the previous definition) after BB
-    * @param dominators: a vector with all the dominators blocks
-    * @param BB: the current basicBlock
-    * @param DT: the DominatorTree advised in order to use the "dominate" methods
-    * @returns: retBlock, the first dominant BasicBlock after BB (BB if BB is a dominator
+    * @function splitEdge:
+    * @param from a block
+    * @param to one of its successors, which has other predecessors
+    * @returns the new block on the edge from -> to (all the identical edges merged), nullptr if it cannot be split
+    **/
+   BasicBlock* splitEdge(BasicBlock* from, BasicBlock* to, LoopInfo& loopData, DominatorTree& DT){
+#if LLVM_VERSION_MAJOR >= 8
+      Instruction* TI = from->getTerminator();
+#else
+      TerminatorInst* TI = from->getTerminator();
+#endif
+      for(unsigned i = 0; i < TI->getNumSuccessors(); ++i){
+	 if(TI->getSuccessor(i) == to){
+	    BasicBlock* edge = SplitCriticalEdge(TI, i, CriticalEdgeSplittingOptions(&DT, &loopData).setMergeIdenticalEdges());
+	    if(edge != nullptr){
+	       edge->setName(from->getName() + ".paz.edge");
+	       numSPLITEDGES++;
+	    }
+	    return edge;
+	 }
+      }
+      return nullptr;
+   }
+
+   /**
+    * @function place_at_exits:
+    * exit tier: every variable is set to 0 once, before the returns and in the dead ends.
+    * It is linear in the size of the function, hence the fallback of the functions over the budget.
+    * @param F the current function
+    * @param DT the dominator tree of F
+    * @returns nothing
     *
     **/
-   BasicBlock* getFirstDom(std::vector<BasicBlock*> &dominators, BasicBlock* BB, DominatorTree& DT){
-      if(std::find(dominators.begin(), dominators.end(), BB) != dominators.end()){//if BB is a dominator, then BB is the first dominator block "after" itself
- 	 return BB;
+   void place_at_exits(Function &F, DominatorTree& DT){
+      PhaseScope phase(timers, "exit tier", F);
+      escaped = slots;//kill_escaped sets them all to 0 before the returns
+      std::vector<BasicBlock*> deadEndBlocks;
+      for(BasicBlock &BB : F){
+	 if(isDeadEnd(&BB) || isa<ResumeInst>(BB.getTerminator())){
+	    deadEndBlocks.push_back(&BB);
+	 }
       }
-      BasicBlock* retBlock = &BB->getParent()->back();//else we start from the last block which contains the return instruction and by definition is a dominator block
-      for(auto it = dominators.begin(), end = dominators.end(); it != end; ++it){//and we iterate over dominators to find the closest to BB
-	 if(DT.properlyDominates(BB, *it)){
-	    retBlock = *it;
+      kill_dynamic_arrays(F, DT);
+      kill_unreachables(deadEndBlocks, F);
+      phase.stop();
+      finish(F);
+   }
+
+   /**
+    * @function spend:
+    * counts one step of the last use analysis
+    * @returns false once the function went over -paz-max-steps
+    **/
+   bool spend(){
+      steps++;
+      return !isOverSteps();
+   }
+
+   bool isOverSteps(){
+      return PaZMaxSteps > 0 && steps > PaZMaxSteps;
+   }
+
+   /**
+    * @function finish:
+    * the placement common to all the tiers: the escaped variables, the coroutine frame, the lifetime markers and the duplicates
+    * @param F the current function
+    * @returns nothing
+    *
+    **/
+   void finish(Function &F){
+      PhaseScope exits(timers, "kill_escaped", F);
+      kill_escaped(F);//the variables kept by a callee are only set to 0 when leaving the function
+      exits.stop();
+      PhaseScope coroutine(timers, "kill_coroutine_frame", F);
+      kill_coroutine_frame(F);//the variables living across a suspension are not allocas but fields of the coroutine frame
+      coroutine.stop();
+      PhaseScope markers(timers, "fit_lifetimes", F);
+      fit_lifetimes(F);//nothing is written in a stack slot the code generator might have given to another variable
+      markers.stop();
+      PhaseScope duplicates(timers, "remove_duplicate_scrubs", F);
+      remove_duplicate_scrubs(F);//once inlined, a function already handled brings its own STORE 0 with it
+      duplicates.stop();
+   }
+
+   /**
+    * @function getTier:
+    * the tier of a function is given, by order of priority, by its paz.tier metadata (!{!"exit"}),
+    * its "paz-tier" attribute, its annotation paz_tier=<tier> (__attribute__((annotate("paz_tier=exit")))) or -paz-tier
+    * @param F the current function
+    * @returns the tier used to place the STORE 0 in F
+    *
+    **/
+   ScrubTier getTier(Function &F){
+      std::string name = PaZTier;
+      auto annotated = annotatedTiers.find(&F);
+      if(annotated != annotatedTiers.end()){
+	 name = annotated->second;
+      }
+      if(F.hasFnAttribute("paz-tier")){
+	 name = F.getFnAttribute("paz-tier").getValueAsString().str();
+      }
+      if(MDNode* N = F.getMetadata("paz.tier")){
+	 if(N->getNumOperands() > 0){
+	    if(MDString* text = dyn_cast<MDString>(N->getOperand(0))){
+	       name = text->getString().str();
+	    }
 	 }
-	 else{
-	    return retBlock;
+      }
+      if(name == "exit"){
+	 return exitTier;
+      }
+      if(name == "balanced"){
+	 return balancedTier;
+      }
+      if(name != "paranoid"){
+	 errs() << "\033[0;31mUnknown tier " << name << " for " << F.getName() << ", paranoid used\033[0;0m\n";
+      }
+      return paranoidTier;
+   }
+
+   /**
+    * @function hoist_loop_scrubs:
+    * balanced tier: the STORE 0 placed inside a loop are executed at each iteration.
+    * When their variable is only used in the outermost loop around them, they are moved at the exits of this loop,
+    * otherwise the variable is set to 0 before the returns, as an escaped variable.
+    * @param F the current function
+    * @param loopData the loops of F
+    * @returns nothing
+    *
+    **/
+   void hoist_loop_scrubs(Function &F, LoopInfo &loopData){
+      reason = "loop exit";
+      std::vector<unsigned> inLoops;
+      for(unsigned i = 0; i < plan.size(); ++i){
+	 AllocaInst* AI = dyn_cast<AllocaInst>(plan[i].address);
+	 if(!plan[i].dropped && AI != nullptr && !isDynamicArray(AI) && getLoopOf(plan[i], loopData) != nullptr){
+	    inLoops.push_back(i);
 	 }
       }
+      std::set<std::pair<std::pair<BasicBlock*, BasicBlock*>, AllocaInst*>> done;
+      for(unsigned i : inLoops){
+	 AllocaInst* AI = cast<AllocaInst>(plan[i].address);
+	 Loop* L = getLoopOf(plan[i], loopData);
+	 while(L->getParentLoop() != nullptr){
+	    L = L->getParentLoop();
+	 }
+	 std::vector<std::pair<BasicBlock*, BasicBlock*>> exits = getExits(L);
+	 bool hoistable = !exits.empty() && isOnlyUsedIn(AI, L);
+	 for(auto exit : exits){
+	    hoistable &= exit.first != nullptr || exit.second->getFirstInsertionPt() != exit.second->end();//catchswitch
+	 }
+	 if(hoistable){
+	    for(auto exit : exits){
+	       if(!done.insert(std::make_pair(exit, AI)).second){
+		  continue;
+	       }
+	       if(exit.first != nullptr){
+		  planOnEdge(AI, exit.first, exit.second);
+	       }
+	       else{
+		  planStore0(PlannedCode(AI), AI, getFirstInsertionCode(exit.second));
+	       }
+	    }
+	 }
+	 else if(!isEscaped(AI)){
+	    escaped.push_back(AI);
+	 }
+	 plan.drop(i);
+	 numLOOPHOISTED++;
+      }
+   }
+
+   /**
+    * @function getLoopOf:
+    * @param S a STORE 0 of the plan, before an instruction or on an edge
+    * @param loopData the loops of the function
+    * @returns the innermost loop around S, nullptr if there is none (the block of a split edge is in the innermost loop around both of its ends)
+    **/
+   Loop* getLoopOf(const ScrubPlacement& S, LoopInfo &loopData){
+      if(S.site == onEdge){
+	 for(Loop* L = loopData.getLoopFor(S.place->getParent()); L != nullptr; L = L->getParentLoop()){
+	    if(L->contains(S.from)){
+	       return L;
+	    }
+	 }
+	 return nullptr;
+      }
+      if(S.site != beforeInstruction){
+	 return nullptr;
+      }
+      return loopData.getLoopFor(S.place->getParent());
+   }
+
+   /**
+    * @function getExits:
+    * @param L a loop
+    * @returns its exits as the plan sees them: (from, to) for an edge split to receive a STORE 0, (nullptr, to) for the block to
+    **/
+   std::vector<std::pair<BasicBlock*, BasicBlock*>> getExits(Loop* L){
+      std::vector<std::pair<BasicBlock*, BasicBlock*>> exits;
+      for(BasicBlock* BB : L->blocks()){
+	 for(auto it = succ_begin(BB), end = succ_end(BB); it != end; ++it){
+	    if(L->contains(*it)){
+	       continue;
+	    }
+	    std::pair<BasicBlock*, BasicBlock*> exit(splitEdges.count(std::make_pair(BB, *it)) ? BB : nullptr, *it);
+	    if(std::find(exits.begin(), exits.end(), exit) == exits.end()){
+	       exits.push_back(exit);
+	    }
+	 }
+      }
+      return exits;
+   }
+
+   /**
+    * @function isOnlyUsedIn:
+    * @param AI a variable
+    * @param L a loop
+    * @returns true if all the accesses to AI (through casts and offsets included) are in L
+    **/
+   bool isOnlyUsedIn(AllocaInst* AI, Loop* L){
+      std::vector<Value*> pointers(1, AI);
+      for(unsigned i = 0; i < pointers.size(); ++i){
+	 for(User* U : pointers[i]->users()){
+	    Instruction* I = dyn_cast<Instruction>(U);
+	    if(I == nullptr){
+	       continue;
+	    }
+	    if(isa<BitCastInst>(I) || isa<GetElementPtrInst>(I)){
+	       pointers.push_back(I);
+	    }
+	    else if(!L->contains(I->getParent())){
+	       return false;
+	    }
+	 }
+      }
+      return true;
+   }
+
+   /**
+    * @function estimate:
+    * computes where the STORE 0 would be added, without modifying the function: the plan is applied to a copy of the function which is then deleted.
+    * Each STORE 0 is weighted by the number of times its block is executed: the product of the trip counts (ScalarEvolution) of the loops around it,
+    * or the static block frequency when one of the trip counts is unknown.
+    * The statistics of the copy are not counted.
+    * @param F the current function
+    * @returns nothing but the estimation is added to the report displayed at the end
+    *
+    **/
+   void estimate(Function& F){
+      PhaseScope phase(timers, "estimate", F);
+      CopyScope copying;
+      ValueToValueMapTy VMap;
+      Function* copy = CloneFunction(&F, VMap);
+      DominatorTree DT(*copy);
+      LoopInfo LI(DT);
+      scrubs.clear();
+      programScrubs.clear();
+      loopInfo = &LI;
+      prepare(*copy, LI, DT);
+      slots = getSlots(*copy);
+      place(*copy, LI, DT);
+      apply(*copy, LI, DT);
+
+      DT.recalculate(*copy);//the analysis of the instrumented copy
+      LI.releaseMemory();
+      LI.analyze(DT);
+      AssumptionCache AC(*copy);
+      ScalarEvolution SE(*copy, getTLI(F), AC, DT, LI);
+      BranchProbabilityInfo BPI(*copy, LI);
+      BlockFrequencyInfo BFI(*copy, BPI, LI);
+      const DataLayout &DL = F.getParent()->getDataLayout();
+
+      FunctionEstimate estimation;
+      estimation.name = F.getName().str();
+      estimation.points = 0;
+      estimation.stores = 0;
+      estimation.bytes = 0;
+      for(Instruction* I : scrubs){
+	 if(I->getFunction() != copy){
+	    continue;
+	 }
+	 double frequency = getFrequency(I->getParent(), LI, SE, BFI);
+	 estimation.points++;
+	 estimation.stores += frequency;
+	 estimation.bytes += frequency * getScrubSize(I, DL);
+      }
+      estimates.push_back(estimation);
+      scrubs.clear();
+      copy->eraseFromParent();
+   }
+
+   /**
+    * @function dry_run:
+    * computes the placement plan of a function without modifying it: the analysis runs on a copy (-paz-optimized changes it first) which is then deleted, the plan is not applied
+    * @param F the current function
+    * @returns nothing but the plan of F is added to the one written at the end
+    *
+    **/
+   void dry_run(Function& F){
+      PhaseScope phase(timers, "dry run", F);
+      ValueToValueMapTy VMap;
+      Function* copy = CloneFunction(&F, VMap);
+      DominatorTree DT(*copy);
+      LoopInfo LI(DT);
+      loopInfo = &LI;
+      prepare(*copy, LI, DT);
+      slots = getSlots(*copy);
+      place(*copy, LI, DT);
+      std::vector<PlannedScrub> placed = getPlannedScrubs(*copy, F.getName(), plan);
+      exportedPlan.insert(exportedPlan.end(), placed.begin(), placed.end());
+      plan.clear();
+      copy->eraseFromParent();
+   }
+
+   /**
+    * @function import_plan:
+    * reads the file of -paz-plan-import, the STORE 0 are gathered by module and function
+    * @returns nothing but importedPlans is filled
+    *
+    **/
+   void import_plan(){
+#if LLVM_VERSION_MAJOR >= 7
+      ErrorOr<std::unique_ptr<MemoryBuffer>> file = MemoryBuffer::getFile(PaZPlanImport);
+      if(!file){
+	 errs() << "\033[0;31m-paz-plan-import: cannot read " << PaZPlanImport << ": " << file.getError().message() << "\033[0;0m\n";
+	 return;
+      }
+      std::vector<PlannedScrub> scrubs;
+      std::string error;
+      if(!readPlan((*file)->getBuffer(), scrubs, error)){
+	 errs() << "\033[0;31m-paz-plan-import: " << PaZPlanImport << ": " << error << "\033[0;0m\n";
+	 return;
+      }
+      for(const PlannedScrub &scrub : scrubs){
+	 importedPlans[std::make_pair(scrub.module, scrub.function)].push_back(scrub);
+      }
+#else
+      errs() << "\033[0;31m-paz-plan-import needs LLVM 7 or later (llvm::json), the analysis is run on every function\033[0;0m\n";
+#endif
+   }
+
+   /**
+    * @function replay_plan:
+    * the plan of F is read from the imported one instead of being computed by the analysis.
+    * Nothing is planned if one of its STORE 0 cannot be found again in F (the code changed, coroutine frame...): the analysis is run instead.
+    * @param F the current function, prepared
+    * @param scrubs the imported plan of F, in the order of its code
+    * @returns true if the plan of F was read
+    *
+    **/
+   bool replay_plan(Function& F, const std::vector<PlannedScrub>& scrubs){
+      PhaseScope phase(timers, "replay plan", F);
+      start_plan(F);
+      const DataLayout &DL = F.getParent()->getDataLayout();
+      std::vector<BasicBlock*> blocks;
+      std::vector<BasicBlock*> unreachables;
+      bool returns = false;
+      for(BasicBlock &BB : F){
+	 blocks.push_back(&BB);
+	 if(isDeadEnd(&BB) || isa<ResumeInst>(BB.getTerminator())){
+	    unreachables.push_back(&BB);
+	 }
+	 returns |= isa<ReturnInst>(BB.getTerminator());
+      }
+      std::vector<AllocaInst*> variables;
+      for(Instruction &I : F.getEntryBlock()){
+	 if(AllocaInst* AI = dyn_cast<AllocaInst>(&I)){
+	    variables.push_back(AI);
+	 }
+      }
+      for(const PlannedScrub &scrub : scrubs){
+	 ScrubPlacement S;
+	 unsigned from = 0;
+	 unsigned to = 0;
+	 bool valid = scrub.isReplayable() && (unsigned)scrub.slot < variables.size();
+	 if(valid && scrub.block == "dead ends"){
+	    S.site = inDeadEnds;
+	    deadEnds.clear();
+	    for(BasicBlock* BB : unreachables){
+	       if(isShareable(BB)){
+		  deadEnds.push_back(BB);
+	       }
+	    }
+	    valid = !deadEnds.empty();
+	 }
+	 else if(valid && scrub.block == "returns"){
+	    S.site = beforeReturns;
+	    valid = returns;
+	 }
+	 else if(valid && sscanf(scrub.block.c_str(), "%u->%u", &from, &to) == 2){
+	    valid = from < blocks.size() && to < blocks.size() && std::find(succ_begin(blocks[from]), succ_end(blocks[from]), blocks[to]) != succ_end(blocks[from]);
+	    valid = valid && blocks[to]->getFirstInsertionPt() != blocks[to]->end();
+	    if(valid){
+	       S.site = onEdge;
+	       S.from = blocks[from];
+	       S.place = &*blocks[to]->getFirstInsertionPt();
+	    }
+	 }
+	 else if(valid && sscanf(scrub.block.c_str(), "%u", &from) == 1){
+	    valid = from < blocks.size() && scrub.position < blocks[from]->size();
+	    if(valid){
+	       S.place = &*std::next(blocks[from]->begin(), scrub.position);
+	    }
+	    if(valid && scrub.reason == ProgramScrubReason){
+	       S.site = programMemSet;
+	       valid = isa<MemSetInst>(S.place);
+	    }
+	    else if(valid && scrub.reason == DuplicateScrubReason){
+	       S.site = removedStore;
+	       valid = isa<StoreInst>(S.place);
+	    }
+	 }
+	 else{
+	    valid = false;
+	 }
+	 if(valid && S.site != programMemSet && S.site != removedStore){
+	    AllocaInst* AI = variables[scrub.slot];
+	    if(scrub.size == 0 || (scrub.offset == 0 && scrub.size >= DL.getTypeStoreSize(AI->getAllocatedType()))){
+	       ScrubPlacement whole;
+	       valid = getStore0(AI, whole);
+	       S.type = whole.type;
+	    }
+	    else{
+	       S.offset = scrub.offset;
+	       S.size = scrub.size;
+	    }
+	 }
+	 if(!valid){
+	    errs() << "\033[0;31m" << F.getName() << ": the plan does not match the function (block " << scrub.block << ", " << scrub.variable << "), the analysis is run\033[0;0m\n";
+	    plan.clear();
+	    return false;
+	 }
+	 S.address = variables[scrub.slot];
+	 S.pass = scrub.pass;
+	 S.reason = scrub.reason;
+	 plan.add(S);
+      }
+      return true;
+   }
+
+   /**
+    * @function export_plan:
+    * writes the plan of the module in the file of -paz-plan-export (the first module handled by the process truncates it), or on stderr for a dry run
+    * @returns nothing
+    *
+    **/
+   void export_plan(){
+      static std::mutex lock;//paz-batch: several modules at once
+      static bool truncated = false;
+      std::lock_guard<std::mutex> guard(lock);
+      if(PaZPlanExport.empty()){
+	 writePlan(errs(), exportedPlan);
+	 return;
+      }
+      std::error_code EC;
+#if LLVM_VERSION_MAJOR >= 9
+      raw_fd_ostream out(PaZPlanExport, EC, truncated ? sys::fs::OF_Append : sys::fs::OF_None);
+#else
+      raw_fd_ostream out(PaZPlanExport, EC, truncated ? sys::fs::F_Append : sys::fs::F_None);
+#endif
+      if(EC){
+	 errs() << "\033[0;31m-paz-plan-export: cannot write " << PaZPlanExport << ": " << EC.message() << "\033[0;0m\n";
+	 return;
+      }
+      truncated = true;
+      writePlan(out, exportedPlan);
+   }
+
+   TargetLibraryInfo& getTLI(Function& F){
+#if LLVM_VERSION_MAJOR >= 10
+      return getAnalysis<TargetLibraryInfoWrapperPass>().getTLI(F);
+#else
+      return getAnalysis<TargetLibraryInfoWrapperPass>().getTLI();
+#endif
+   }
+
+   /**
+    * @function getFrequency:
+    * @param BB a basic block
+    * @returns the estimated number of executions of BB for one call to its function
+    *
+    **/
+   double getFrequency(BasicBlock* BB, LoopInfo& LI, ScalarEvolution& SE, BlockFrequencyInfo& BFI){
+      double frequency = 1;
+      for(Loop* L = LI.getLoopFor(BB); L != nullptr; L = L->getParentLoop()){
+	 unsigned tripCount = SE.getSmallConstantTripCount(L);
+	 if(tripCount == 0){//unknown
+	    return (double)BFI.getBlockFreq(BB).getFrequency() / BFI.getEntryFreq();
+	 }
+	 frequency *= tripCount;
+      }
+      return frequency;
+   }
+
+   /**
+    * @function getScrubSize:
+    * @param I a STORE 0 added by the pass
+    * @returns the number of bytes it sets to 0
+    *
+    **/
+   uint64_t getScrubSize(Instruction* I, const DataLayout& DL){
+      if(StoreInst* SI = dyn_cast<StoreInst>(I)){
+	 return DL.getTypeStoreSize(SI->getValueOperand()->getType());
+      }
+      if(MemSetInst* MSI = dyn_cast<MemSetInst>(I)){//0 if the size is only known at runtime
+	 if(ConstantInt* length = dyn_cast<ConstantInt>(MSI->getLength())){
+	    return length->getZExtValue();
+	 }
+      }
+      return 0;
+   }
+
+   /**
+    * @function isDeadEnd:
+    * is the given block a dead end?
+    * @param BasicBlock* BB the block to test
+    * @returns true if the block contains an unreachable instruction ---> is a dead end (no successor but not a normal exit either)
+    * false elsewhere
+    *
+    **/
+   bool isDeadEnd(BasicBlock* BB){
+      Instruction* I = BB->getTerminator();//for all the instructions in the block
+      while(I != nullptr){
+	 if(UnreachableInst* CI = dyn_cast<UnreachableInst>(I)){//if I is an unreachable instruction
+	    return true;//the block is a dead end
+	 }
+	 I = I->getPrevNode();
+      }
+      return false;
+   }
+
+   /**
+    * @function getReturning:
+    * @param F, the current function
+    * @returns the blocks from which the last block (the return one) can be reached: the walk back never visits the others
+    **/
+   std::set<BasicBlock*> getReturning(Function& F){
+      std::set<BasicBlock*> returning;
+      std::vector<BasicBlock*> toVisit(1, &F.back());
+      while(!toVisit.empty()){
+	 BasicBlock* BB = toVisit.back();
+	 toVisit.pop_back();
+	 if(!returning.insert(BB).second){
+	    continue;
+	 }
+	 for(auto it = pred_begin(BB), it_end = pred_end(BB); it != it_end; ++it){
+	    toVisit.push_back(*it);
+	 }
+      }
+      return returning;
+   }
+
+   /**
+    * @function getFirstDom:
+    * returns the first dominator block (according to the previous definition) after BB
+    * @param dominators: a vector with all the dominators blocks
+    * @param BB: the current basicBlock
+    * @param DT: the DominatorTree advised in order to use the "dominate" methods
+    * @returns: retBlock, the first dominant BasicBlock after BB (BB if BB is a dominator
+    *
+    **/
+   BasicBlock* getFirstDom(std::vector<BasicBlock*> &dominators, BasicBlock* BB, DominatorTree& DT){
+      if(std::find(dominators.begin(), dominators.end(), BB) != dominators.end()){//if BB is a dominator, then BB is the first dominator block "after" itself
+ 	 return BB;
+      }
+      BasicBlock* retBlock = &BB->getParent()->back();//else we start from the last block which contains the return instruction and by definition is a dominator block
+      for(auto it = dominators.begin(), end = dominators.end(); it != end; ++it){//and we iterate over dominators to find the closest to BB
+	 if(DT.properlyDominates(BB, *it)){
+	    retBlock = *it;
+	 }
+	 else{
+	    return retBlock;
+	 }
+      }
+      return retBlock;
+   }
+
+   /**
+    * @function array_handler:
+    * handle array which are some "weird variables" and put a 0 in all their cases after the "last use" (last access to an array case)
+    * @param F the current running function
+    * @param dominator_blocks, the vector containing all the dominators
+    * @param DT the dominator tree, for method calling purposes
+    * @returns: nothing but the arrays are handled in a way such as if they were variables
+    *
+    **/
+   void array_handler(Function& F, std::vector<BasicBlock*> &dominator_blocks, DominatorTree& DT){
+      reason = "array";
+      PhaseScope phase(timers, "array_handler", F);
+      AssumptionCache AC(F);
+      ScalarEvolution SE(F, getTLI(F), AC, DT, *loopInfo);//the ranges of the indexes
+      std::vector<AllocaInst*> atZeroArrays;//arrays already to 0
+      BasicBlock* BB = &F.back();
+      while(BB != nullptr){
+	 Instruction* I = BB->getTerminator();
+	 while(I != nullptr){//we iterate over the instructions from the last one to the first one to find any array access
+	    std::vector<AllocaInst*> arrays;
+	    if(isa<LoadInst>(I) || isa<StoreInst>(I)){//a case (or a field) read or written through its address (a getelementptr)
+	       Value* pointer = I->getOperand(I->getNumOperands() - 1);
+	       AllocaInst* AI = dyn_cast<AllocaInst>(pointer->stripInBoundsOffsets());
+	       if(AI != nullptr && AI != pointer && AI->getAllocatedType()->isAggregateType() && !isDynamicArray(AI)){//we check that it access a fixed size array
+		  arrays.push_back(AI);
+	       }
+	    }
+	    else if(CallInst* CI = dyn_cast<CallInst>(I)){//an array given to a function is used until the end of the call
+	       arrays = getArrayArguments(CI);
+	    }
+	    for(AllocaInst* AI : arrays){
+	       if(!isEscaped(AI) && std::find(atZeroArrays.begin(), atZeroArrays.end(), AI) == atZeroArrays.end()){
+		  dead_array(I, AI, dominator_blocks, DT, SE);
+		  atZeroArrays.push_back(AI);
+	       }
+	    }
+	    I = I->getPrevNode();
+	 }
+	 BB = BB->getPrevNode();
+      }
+   }
+
+   /**
+    * @function dead_array:
+    * properly set all the cases to zero once the array is dead.
+    * Only the bytes which were written are set to 0 (see getWrittenRanges), unless a STORE 0 of the whole array is cheaper.
+    * @param I, the last Instruction using the variable
+    * @param AI, the array
+    * @param dominators, the dominators
+    * @param DT, the dominatorTree for method purposes
+    * @param SE, the ranges of the indexes
+    * @returns nothing but the array is put to 0 once and for all
+    *
+    **/
+   void dead_array(Instruction* I, AllocaInst* AI, std::vector<BasicBlock*> &dominators, DominatorTree &DT, ScalarEvolution &SE){
+   	 BasicBlock* BB = getFirstDom(dominators, I->getParent(), DT);
+	 PlannedCode place = plan.getNext(PlannedCode(I));
+	 if(BB != I->getParent()){
+	    place = plan.getCode(BB).front();
+	 }
+	 ByteRanges ranges;
+	 if(getWrittenRanges(AI, SE, ranges) && isCheaperThanWhole(AI, ranges)){
+	    for(auto range : ranges){
+	       planRangeStore0(AI, range, place);
+	    }
+	 }
+	 else{
+	    planStore0(PlannedCode(I), AI, place);
+	 }
+   }
+
+   /**
+    * @function getWrittenRanges:
+    * @param AI, an array or a structure
+    * @param SE, the ranges of the indexes
+    * @param ranges, filled with the bytes of AI written in the function (sorted, merged)
+    * @returns false if the bytes written are unknown (unknown index, unknown callee, address kept...)
+    *
+    **/
+   bool getWrittenRanges(AllocaInst* AI, ScalarEvolution &SE, ByteRanges &ranges){
+      const DataLayout &DL = AI->getModule()->getDataLayout();
+      int64_t size = DL.getTypeAllocSize(AI->getAllocatedType());
+      if(!collect_written(AI, 0, 0, size, SE, ranges)){
+	 return false;
+      }
+      std::sort(ranges.begin(), ranges.end());
+      ByteRanges merged;
+      for(auto range : ranges){
+	 if(!merged.empty() && range.first <= merged.back().second){
+	    merged.back().second = std::max(merged.back().second, range.second);
+	 }
+	 else{
+	    merged.push_back(range);
+	 }
+      }
+      ranges = merged;
+      return true;
+   }
+
+   /**
+    * @function collect_written:
+    * follows the uses of an address inside a variable to find the bytes written through it
+    * @param V, the address
+    * @param low, high, the smallest and the largest offsets of V in the variable
+    * @param size, the size of the variable
+    * @param SE, the ranges of the indexes
+    * @param ranges, the bytes written
+    * @returns false if the bytes written through V are unknown
+    *
+    **/
+   bool collect_written(Value* V, int64_t low, int64_t high, int64_t size, ScalarEvolution &SE, ByteRanges &ranges){
+      const DataLayout &DL = cast<Instruction>(V)->getModule()->getDataLayout();
+      for(User* U : V->users()){
+	 Instruction* I = dyn_cast<Instruction>(U);
+	 if(I == nullptr){
+	    return false;
+	 }
+	 if(isa<LoadInst>(I) || isAStore0Inst(*I)){//setting a case to 0 does not need to be undone
+	    continue;
+	 }
+	 if(StoreInst* SI = dyn_cast<StoreInst>(I)){
+	    if(SI->getValueOperand() == V){//the address itself is stored
+	       return false;
+	    }
+	    if(!addRange(low, high + DL.getTypeStoreSize(SI->getValueOperand()->getType()), size, ranges)){
+	       return false;
+	    }
+	 }
+	 else if(isa<BitCastInst>(I)){
+	    if(!collect_written(I, low, high, size, SE, ranges)){
+	       return false;
+	    }
+	 }
+	 else if(GetElementPtrInst* GEP = dyn_cast<GetElementPtrInst>(I)){
+	    int64_t offsetLow = 0;
+	    int64_t offsetHigh = 0;
+	    if(GEP->getPointerOperand() != V || !getOffsetRange(GEP, SE, size, offsetLow, offsetHigh)){
+	       return false;
+	    }
+	    if(!collect_written(GEP, low + offsetLow, high + offsetHigh, size, SE, ranges)){
+	       return false;
+	    }
+	 }
+	 else if(CallInst* CI = dyn_cast<CallInst>(I)){
+	    if(!collect_call_written(CI, V, low, high, size, SE, ranges)){
+	       return false;
+	    }
+	 }
+	 else{//phi, select, converted to an integer...
+	    return false;
+	 }
+      }
+      return true;
+   }
+
+   /**
+    * @function collect_call_written:
+    * @param CI, a call receiving the address V
+    * @returns false if the callee might write an unknown number of bytes through V
+    **/
+   bool collect_call_written(CallInst* CI, Value* V, int64_t low, int64_t high, int64_t size, ScalarEvolution &SE, ByteRanges &ranges){
+      if(getCalledPointer(CI) == V){
+	 return false;
+      }
+      if(MemSetInst* MSI = dyn_cast<MemSetInst>(CI)){//a memset to 0 is already a STORE 0
+	 if(Constant* C = dyn_cast<Constant>(MSI->getValue())){
+	    if(C->isNullValue()){
+	       return true;
+	    }
+	 }
+      }
+      for(unsigned i = 0; i < getNumCallArgs(CI); ++i){
+	 if(CI->getArgOperand(i) != V || !(summaries.getEffect(CI, i) & writes)){
+	    continue;
+	 }
+	 int lengthArg = summaries.getWriteLength(CI);
+	 int64_t lengthLow = 0;
+	 int64_t lengthHigh = 0;
+	 if(lengthArg < 0 || !getValueRange(CI->getArgOperand(lengthArg), SE, lengthLow, lengthHigh)){
+	    return false;
+	 }
+	 if(!addRange(low, high + lengthHigh, size, ranges)){
+	    return false;
+	 }
+      }
+      return true;
+   }
+
+   /**
+    * @function getOffsetRange:
+    * @param GEP, an address computation
+    * @param SE, the ranges of the indexes
+    * @param size, the size of the variable, larger offsets are not worth following
+    * @param low, high, set to the smallest and the largest offsets (in bytes) GEP adds to its pointer
+    * @returns false if an index is unknown
+    *
+    **/
+   bool getOffsetRange(GetElementPtrInst* GEP, ScalarEvolution &SE, int64_t size, int64_t &low, int64_t &high){
+      const DataLayout &DL = GEP->getModule()->getDataLayout();
+      Type* T = GEP->getSourceElementType();
+      low = 0;
+      high = 0;
+      for(auto it = GEP->idx_begin(), et = GEP->idx_end(); it != et; ++it){
+	 if(it != GEP->idx_begin()){
+	    if(StructType* ST = dyn_cast<StructType>(T)){//the field index is always a constant
+	       unsigned field = cast<ConstantInt>(*it)->getZExtValue();
+	       low += DL.getStructLayout(ST)->getElementOffset(field);
+	       high += DL.getStructLayout(ST)->getElementOffset(field);
+	       T = ST->getElementType(field);
+	       continue;
+	    }
+	    if(ArrayType* AT = dyn_cast<ArrayType>(T)){
+	       T = AT->getElementType();
+	    }
+	    else if(VectorType* VT = dyn_cast<VectorType>(T)){
+	       T = VT->getElementType();
+	    }
+	    else{
+	       return false;
+	    }
+	 }
+	 int64_t indexLow = 0;
+	 int64_t indexHigh = 0;
+	 if(!getValueRange(*it, SE, indexLow, indexHigh)){
+	    return false;
+	 }
+	 int64_t elementSize = DL.getTypeAllocSize(T);
+	 if(indexLow < -size || indexHigh > size){//out of the variable: the index is not bounded
+	    return false;
+	 }
+	 low += indexLow * elementSize;
+	 high += indexHigh * elementSize;
+      }
+      return true;
+   }
+
+   /**
+    * @function getValueRange:
+    * @param V, an integer
+    * @param SE, the ranges of the values computed in loops
+    * @param low, high, set to the smallest and the largest value V can take
+    * @returns false if nothing is known about V
+    *
+    **/
+   bool getValueRange(Value* V, ScalarEvolution &SE, int64_t &low, int64_t &high){
+      if(ConstantInt* C = dyn_cast<ConstantInt>(V)){
+	 low = high = C->getSExtValue();
+	 return true;
+      }
+      if(!SE.isSCEVable(V->getType())){
+	 return false;
+      }
+      ConstantRange range = SE.getSignedRange(SE.getSCEV(V));
+      if(range.isFullSet() || range.getBitWidth() > 64){
+	 return false;
+      }
+      low = range.getSignedMin().getSExtValue();
+      high = range.getSignedMax().getSExtValue();
+      return true;
+   }
+
+   /**
+    * @function addRange:
+    * adds the bytes [begin, end) to the bytes written, cut to the bounds of the variable
+    * @returns false if the range is entirely out of the variable
+    **/
+   bool addRange(int64_t begin, int64_t end, int64_t size, ByteRanges &ranges){
+      begin = std::max<int64_t>(begin, 0);
+      end = std::min<int64_t>(end, size);
+      if(begin >= end){
+	 return false;
+      }
+      ranges.push_back(std::make_pair(begin, end));
+      return true;
+   }
+
+   /**
+    * @function isCheaperThanWhole:
+    * a memset costs about as much as setting ScrubCallCost bytes to 0 on top of the bytes it sets
+    * @returns true if setting the ranges to 0 one by one costs less than setting the whole variable to 0
+    **/
+   bool isCheaperThanWhole(AllocaInst* AI, ByteRanges &ranges){
+      const uint64_t ScrubCallCost = 64;
+      const DataLayout &DL = AI->getModule()->getDataLayout();
+      uint64_t cost = 0;
+      for(auto range : ranges){
+	 cost += ScrubCallCost + range.second - range.first;
+      }
+      return cost < ScrubCallCost + DL.getTypeAllocSize(AI->getAllocatedType());
+   }
+
+   /**
+    * @function planRangeStore0:
+    * plans a volatile memset of some bytes of a variable to 0
+    * @param AI, the variable
+    * @param range, the bytes
+    * @param place, the instruction or the STORE 0 before which the memset goes
+    * @returns its index in the plan
+    *
+    **/
+   int planRangeStore0(AllocaInst* AI, std::pair<uint64_t, uint64_t> range, PlannedCode place){
+      if(!place.isScrub() && (isa<PHINode>(place.instruction) || place.instruction->isEHPad())){
+	 place = getFirstInsertionCode(place.instruction->getParent());
+      }
+      ScrubPlacement S;
+      S.address = AI;
+      S.offset = range.first;
+      S.size = range.second - range.first;
+      S.trigger = place;
+      S.pass = "PutAtZero";
+      S.reason = reason.str();
+      return planBefore(S, place);
+   }
+
+   /**
+    * @function addRangeStore0:
+    * sets some bytes of a variable (or of a coroutine frame) to 0 with a volatile memset
+    * @param S, the memset planned
+    * @param place, the instruction before which it is added
+    * @param trigger, the instruction giving its debug location
+    * @returns the memset
+    *
+    **/
+   Instruction* addRangeStore0(const ScrubPlacement& S, Instruction* place, Instruction* trigger){
+      Value* address = S.address;
+      IRBuilder<> Builder(place);
+      Value* bytes = Builder.CreateBitCast(address, Builder.getInt8PtrTy(address->getType()->getPointerAddressSpace()));
+      Value* begin = bytes;
+      if(S.offset != 0){
+	 begin = GetElementPtrInst::CreateInBounds(Builder.getInt8Ty(), bytes, {Builder.getInt64(S.offset)}, "paz.range", place);
+      }
+      unsigned align = 0;
+      if(AllocaInst* AI = dyn_cast<AllocaInst>(address)){
+	 align = MinAlign(AI->getAlignment(), S.offset);
+      }
+      else{//the frame of a coroutine
+	 align = place->getModule()->getDataLayout().getABITypeAlignment(address->getType()->getPointerElementType());
+      }
+#if LLVM_VERSION_MAJOR >= 10
+      CallInst* memset = Builder.CreateMemSet(begin, Builder.getInt8(0), S.size, MaybeAlign(align), true);
+#else
+      CallInst* memset = Builder.CreateMemSet(begin, Builder.getInt8(0), S.size, align, true);
+#endif
+      tagScrub(memset, address, "PutAtZero", trigger, S.reason);
+      scrubs.push_back(memset);
+      numSTORE0ADDED++;
+      return memset;
+   }
+
+   /**
+    * @function isDynamicArray:
+    * @param AI a variable
+    * @returns true if AI holds a number of elements given by an operand (VLA, alloca(n)) instead of a single value of its type
+    **/
+   bool isDynamicArray(AllocaInst* AI){
+      return AI->isArrayAllocation();
+   }
+
+   /**
+    * @function kill_dynamic_arrays:
+    * sets the dynamic arrays to 0 when their memory is given back: before the llvm.stackrestore ending their scope (C99 VLA),
+    * or before the returns for the ones which live until the end of the function (alloca(n)).
+    * Their uses are not followed: the whole array is set to 0 at once (see addStore0).
+    * @param F, the current function
+    * @param DT, the dominator tree
+    * @returns nothing
+    *
+    **/
+   void kill_dynamic_arrays(Function& F, DominatorTree& DT){
+      reason = "dynamic array";
+      std::vector<AllocaInst*> arrays;
+      std::vector<IntrinsicInst*> restores;
+      std::vector<ReturnInst*> returns;
+      for(BasicBlock &BB : F){
+	 for(Instruction &I : BB){
+	    AllocaInst* AI = dyn_cast<AllocaInst>(&I);
+	    IntrinsicInst* II = dyn_cast<IntrinsicInst>(&I);
+	    if(AI != nullptr && isDynamicArray(AI)){
+	       arrays.push_back(AI);
+	    }
+	    else if(II != nullptr && II->getIntrinsicID() == Intrinsic::stackrestore){
+	       restores.push_back(II);
+	    }
+	    else if(ReturnInst* RI = dyn_cast<ReturnInst>(&I)){
+	       returns.push_back(RI);
+	    }
+	 }
+      }
+      for(AllocaInst* AI : arrays){
+	 bool released = false;
+	 for(IntrinsicInst* restore : restores){
+	    if(DT.dominates(AI, restore) && isSavedBefore(restore, AI, DT)){
+	       planStore0(PlannedCode(AI), AI, PlannedCode(restore));
+	       released = true;
+	    }
+	 }
+	 if(released){
+	    continue;
+	 }
+	 for(ReturnInst* RI : returns){
+	    if(DT.dominates(AI, RI)){
+	       planStore0(PlannedCode(AI), AI, PlannedCode(RI));
+	    }
+	    else{
+	       errs() << "can't set the dynamic array " << AI->getName() << " to 0 on every exit\n";
+	    }
+	 }
+      }
+   }
+
+   /**
+    * @function isSavedBefore:
+    * @param restore a call to llvm.stackrestore
+    * @param AI a dynamic array
+    * @returns true if the stack pointer restored was saved (llvm.stacksave) before AI was allocated: restore gives the memory of AI back.
+    * The saved pointer is used directly (optimized code) or kept in a local variable (unoptimized code).
+    **/
+   bool isSavedBefore(IntrinsicInst* restore, AllocaInst* AI, DominatorTree& DT){
+      std::vector<Value*> saved;
+      Value* pointer = restore->getArgOperand(0);
+      if(LoadInst* LI = dyn_cast<LoadInst>(pointer)){
+	 for(User* U : LI->getPointerOperand()->users()){
+	    if(StoreInst* SI = dyn_cast<StoreInst>(U)){
+	       saved.push_back(SI->getValueOperand());
+	    }
+	 }
+      }
+      else{
+	 saved.push_back(pointer);
+      }
+      for(Value* V : saved){
+	 IntrinsicInst* save = dyn_cast<IntrinsicInst>(V);
+	 if(save != nullptr && save->getIntrinsicID() == Intrinsic::stacksave && DT.dominates(save, AI)){
+	    return true;
+	 }
+      }
+      return false;
+   }
+
+   /**
+    * @function kill_unreachables:
+    * put all the variables to the 0 value (regardless of both their type and current value) in all the "dead end" blocks to insure that everything is back to normal at any exit of the function.
+    * Instead of copying the STORE 0 in each dead end, all of them branch to a single shared block which sets the variables to 0
+    * and then jumps back to the dead end it came from:
+    *
+    *	 dead end 1      dead end 2              dead end 1      dead end 2
+    *	 call abort      resume             ->        \              /
+    *	                                               paz.cold.scrub (STORE 0 of every variable, or a call to the cold function holding them)
+    *	                                               /              \
+    *	                                         call abort       resume
+    *
+    * With -paz-outline-cold, the STORE 0 are moved in a cold function so that they do not take any room in the function itself.
+    * The blocks are made when the plan is applied (add_cold_exits).
+    * A dead end whose phi nodes or landing pad are used after them (resume %lp), or which still uses a variable (a cleanup), keeps its own STORE 0,
+    * after the last use of a variable: re-entered from the shared block, the phi nodes and the landing pad would not dominate their uses any more.
+    * @param unreachables, a vector with all the blocks containing an unreachable (or resume) instruction.
+    * @param F, the current function
+    * @returns nothing but sets all the variable used in all the function to 0
+    *
+    **/
+
+   void kill_unreachables(std::vector<BasicBlock*> unreachables, Function& F){
+      reason = "dead end";
+      PhaseScope phase(timers, "kill_unreachables", F);
+      std::vector<BasicBlock*> own;//the dead ends which cannot be shared
+      for(BasicBlock* BB : unreachables){
+	 if(isShareable(BB)){
+	    deadEnds.push_back(BB);
+	 }
+	 else{
+	    own.push_back(BB);
+	 }
+      }
+      BasicBlock* firstBlock = &F.front();
+      for(Instruction& I : *firstBlock){
+	 AllocaInst* AI = dyn_cast<AllocaInst>(&I);
+	 ScrubPlacement S;
+	 if(AI == nullptr || isDynamicArray(AI)){
+	    continue;
+	 }
+	 if(isAliveAtOne(AI, deadEnds) && getStore0(AI, S)){
+	    S.site = inDeadEnds;
+	    S.use = AI;
+	    plan.add(S);
+	 }
+	 for(BasicBlock* BB : own){
+	    PlannedCode next = getDeadEndCode(BB);
+	    Instruction* place = next.isScrub() ? plan[next.scrub].place : next.instruction;
+	    if(lifetimes.isAlive(AI, place)){
+	       planStore0(PlannedCode(AI), AI, next);
+	    }
+	 }
+      }
+      if(!plan.getInDeadEnds().empty()){
+	 return;
+      }
+      deadEnds.clear();//no shared block
+   }
+
+   /**
+    * @function isShareable:
+    * @param BB, a dead end
+    * @returns true if none of its phi nodes and landing pad is used and no variable is used after them:
+    * the rest of the block can come back after the shared block
+    **/
+   bool isShareable(BasicBlock* BB){
+      Instruction* split = &*BB->getFirstInsertionPt();
+      bool after = false;
+      for(Instruction &I : *BB){
+	 after |= &I == split;
+	 if((!after && !I.use_empty()) || (after && usesAVariable(&I))){
+	    return false;
+	 }
+      }
+      return true;
+   }
+
+   /**
+    * @function getDeadEndCode:
+    * @param BB, a dead end kept aside (not shareable)
+    * @returns the instruction or STORE 0 of the plan following the last use of a variable in BB, the first insertion point if there is none
+    **/
+   PlannedCode getDeadEndCode(BasicBlock* BB){
+      PlannedCode last;
+      for(PlannedCode C : plan.getCode(BB)){
+	 if(!C.isScrub() && usesAVariable(C.instruction)){
+	    last = C;
+	 }
+      }
+      return last.isEnd() ? getFirstInsertionCode(BB) : plan.getNext(last);
+   }
+
+   /**
+    * @function usesAVariable:
+    * @param I, an instruction
+    * @returns true if one of its operands is the address of a variable, of one of its fields or one of its elements
+    **/
+   bool usesAVariable(Instruction* I){
+      for(Value* V : I->operands()){
+	 AllocaInst* AI = V->getType()->isPointerTy() ? dyn_cast<AllocaInst>(V->stripInBoundsOffsets()) : nullptr;
+	 if(AI != nullptr && !isExceptionSlot(AI)){//never set to 0
+	    return true;
+	 }
+      }
+      return false;
+   }
+
+   /**
+    * @function isExceptionSlot:
+    * @param AI, a variable
+    * @returns true if it keeps the exception or the selector given by a landing pad (exn.slot and ehselector.slot of clang -O0)
+    **/
+   bool isExceptionSlot(AllocaInst* AI){
+      for(User* U : AI->users()){
+	 StoreInst* SI = dyn_cast<StoreInst>(U);
+	 if(SI == nullptr || SI->getPointerOperand() != AI){
+	    continue;
+	 }
+	 Value* V = SI->getValueOperand();
+	 if(ExtractValueInst* EVI = dyn_cast<ExtractValueInst>(V)){
+	    V = EVI->getAggregateOperand();
+	 }
+	 if(isa<LandingPadInst>(V)){
+	    return true;
+	 }
+      }
+      return false;
+   }
+
+   /**
+    * @function add_cold_exits:
+    * makes the block shared by the dead ends planned by kill_unreachables
+    * @param F, the current function
+    * @param body, set to the block which receives the STORE 0
+    * @returns the instruction before which the STORE 0 are added
+    **/
+   Instruction* add_cold_exits(Function& F, BasicBlock*& body){
+      LLVMContext &context = F.getContext();
+      BasicBlock* head = BasicBlock::Create(context, "paz.cold.scrub", &F);
+      body = BasicBlock::Create(context, "paz.cold.scrub.body", &F);
+      BasicBlock* dispatch = BasicBlock::Create(context, "paz.cold.scrub.dispatch", &F);
+      PHINode* from = PHINode::Create(Type::getInt32Ty(context), deadEnds.size(), "paz.from", head);
+      BranchInst::Create(body, head);
+      Instruction* bodyEnd = BranchInst::Create(dispatch, body);
+      SwitchInst* SI = SwitchInst::Create(from, nullptr, deadEnds.size(), dispatch);
+      int i = 0;
+      for(BasicBlock* deadEnd : deadEnds){
+	 //the dead end keeps its phi nodes and landing pad, the rest of it comes back after the shared block
+	 BasicBlock* rest = deadEnd->splitBasicBlock(deadEnd->getFirstInsertionPt(), deadEnd->getName() + ".paz.exit");
+	 deadEnd->getTerminator()->eraseFromParent();
+	 BranchInst::Create(head, deadEnd);
+	 from->addIncoming(ConstantInt::get(Type::getInt32Ty(context), i), deadEnd);
+	 if(i == 0){
+	    SI->setDefaultDest(rest);
+	 }
+	 else{
+	    SI->addCase(ConstantInt::get(Type::getInt32Ty(context), i), rest);
+	 }
+	 numCOLDEXITS++;
+	 i++;
+      }
+      return bodyEnd;
+   }
+
+   /**
+    * @function isAliveAtOne:
+    * @param AI, a variable
+    * @param blocks, the dead end blocks
+    * @returns true if AI may be alive (between its lifetime markers) when one of the blocks is reached
+    **/
+   bool isAliveAtOne(AllocaInst* AI, std::vector<BasicBlock*> &blocks){
+      for(BasicBlock* BB : blocks){
+	 if(lifetimes.isAlive(AI, &*BB->getFirstInsertionPt())){
+	    return true;
+	 }
+      }
+      return false;
+   }
+
+   /**
+    * @function outline_cold:
+    * moves a block in a new function marked as cold, placed in the .text.unlikely section away from the hot code.
+    * The addresses of the variables are given to it in a single structure.
+    * @param F, the current function
+    * @param body, the block to move (single entry, single exit)
+    * @returns nothing
+    *
+    **/
+   void outline_cold(Function& F, BasicBlock* body){
+      std::vector<BasicBlock*> region;
+      region.push_back(body);
+      CodeExtractor extractor(region, nullptr, true);
+      if(!extractor.isEligible()){
+	 return;
+      }
+      std::set<Instruction*> program;
+      for(Instruction &I : F.getEntryBlock()){
+	 program.insert(&I);
+      }
+#if LLVM_VERSION_MAJOR >= 10
+      CodeExtractorAnalysisCache CEAC(F);
+      Function* cold = extractor.extractCodeRegion(CEAC);
+#else
+      Function* cold = extractor.extractCodeRegion();
+#endif
+      if(cold == nullptr){
+	 return;
+      }
+      cold->addFnAttr(Attribute::Cold);
+      cold->addFnAttr(Attribute::NoInline);
+      cold->setSection(".text.unlikely");//the calls to a cold function are also considered as unlikely by the branch probabilities
+      coldFunctions.insert(cold);
+      for(Instruction &I : F.getEntryBlock()){
+	 if(isa<AllocaInst>(&I) && !program.count(&I)){//the arguments of the cold function (AggregateArgs), not a variable of the program
+	    I.setName("paz." + I.getName());
+	 }
+      }
+   }
+
+   /**
+    * @function getCoroutineFrame:
+    * CoroSplit gives the frame of a coroutine (the variables living across a suspension point, on the heap) as first argument
+    * of its clones f.resume, f.destroy and f.cleanup; its type is the structure %f.Frame
+    * @param F, the current function
+    * @returns the frame if F is the f.destroy or f.cleanup clone of a coroutine, nullptr elsewhere
+    **/
+   Argument* getCoroutineFrame(Function& F){
+      if(F.arg_empty() || !(F.getName().endswith(".destroy") || F.getName().endswith(".cleanup"))){
+	 return nullptr;
+      }
+      Argument* frame = &*F.arg_begin();
+      PointerType* type = dyn_cast<PointerType>(frame->getType());
+      if(type == nullptr){
+	 return nullptr;
+      }
+      StructType* layout = dyn_cast<StructType>(type->getElementType());
+      if(layout == nullptr || !layout->hasName()){
+	 return nullptr;
+      }
+      StringRef name = layout->getName();
+      if(!name.endswith(".Frame")){//the types of modules sharing a context (paz-batch, LTO) are renamed f.Frame.1, f.Frame.2...
+	 name = name.rtrim("0123456789");
+	 if(!name.endswith(".Frame.")){
+	    return nullptr;
+	 }
+      }
+      return frame;
+   }
+
+   /**
+    * @function kill_coroutine_frame:
+    * sets the whole frame of a coroutine to 0 with one memset over its layout when it is destroyed:
+    * right before it is freed in f.destroy, or before the returns of f.cleanup (frame allocation elided, the frame is in the caller).
+    * A f.destroy whose free is not found is left as it is: the frame may already be freed when it returns.
+    * Nothing is added to f.resume: the fields are not set to 0 one by one at each suspension.
+    * @param F, the current function
+    * @returns nothing
+    *
+    **/
+   void kill_coroutine_frame(Function& F){
+      reason = "coroutine frame";
+      Argument* frame = getCoroutineFrame(F);
+      if(frame == nullptr){
+	 return;
+      }
+      std::vector<Instruction*> places;
+      for(BasicBlock &BB : F){
+	 for(Instruction &I : BB){
+	    const CallInst* CI = isFreeCall(&I, &getTLI(F));//free, operator delete or the deallocation function of the coroutine
+	    if(CI != nullptr && CI->getArgOperand(0)->stripPointerCasts() == frame){
+	       places.push_back(&I);
+	    }
+	 }
+      }
+      if(places.empty() && F.getName().endswith(".destroy")){//freed elsewhere (a custom deallocation), or not at all
+	 return;
+      }
+      const DataLayout &DL = F.getParent()->getDataLayout();
+      ScrubPlacement S;
+      S.address = frame;
+      S.size = DL.getTypeAllocSize(frame->getType()->getPointerElementType());
+      S.pass = "PutAtZero";
+      S.reason = reason.str();
+      if(places.empty() && !plan.getBeforeReturns().empty()){//f.cleanup, the returns are merged: once, after the escaped variables
+	 S.site = beforeReturns;
+	 plan.add(S);
+      }
+      else if(places.empty()){
+	 for(BasicBlock &BB : F){
+	    if(isa<ReturnInst>(BB.getTerminator())){
+	       places.push_back(BB.getTerminator());
+	    }
+	 }
+      }
+      for(Instruction* place : places){
+	 S.trigger = PlannedCode(place);
+	 planBefore(S, PlannedCode(place));
+      }
+      numCOROFRAMES++;
+   }
+
+   /**
+    * @function fit_lifetimes:
+    * once its variable is out of its lifetime markers, StackColoring may have given its stack slot to another variable:
+    * a STORE 0 placed there would overwrite it. Such STORE 0 are moved where the variable is still alive:
+    * right before its llvm.lifetime.end when they come after it (returns, escaped variables),
+    * right after its llvm.lifetime.start when they come before it (the initialization in the first block).
+    * The markers are kept as they are, so the frame keeps the size it has without the pass.
+    * @param F, the current function
+    * @returns nothing
+    *
+    **/
+   void fit_lifetimes(Function& F){
+      reason = "lifetime";
+      std::vector<unsigned> misplaced;
+      for(unsigned i = 0; i < plan.size(); ++i){
+	 const ScrubPlacement &S = plan[i];
+	 AllocaInst* AI = dyn_cast<AllocaInst>(S.address);
+	 bool moved = S.site == beforeInstruction || S.site == onEdge || S.site == beforeReturns;//the dead ends are only reached while their variables are alive
+	 if(!S.dropped && moved && AI != nullptr && lifetimes.hasMarkers(AI) && !isAliveAt(S, AI, F)){
+	    misplaced.push_back(i);
+	 }
+      }
+      for(unsigned i : misplaced){
+	 AllocaInst* AI = cast<AllocaInst>(plan[i].address);
+	 if(isStartedAt(plan[i], AI, F)){
+	    for(IntrinsicInst* end : lifetimes.getEnds(AI)){
+	       rescrub(i, AI, PlannedCode(end));
+	    }
+	 }
+	 else{
+	    for(IntrinsicInst* start : lifetimes.getStarts(AI)){
+	       rescrub(i, AI, plan.getNext(PlannedCode(start)));
+	    }
+	 }
+	 plan.drop(i);
+	 numLIFETIMEMOVED++;
+      }
+   }
+
+   /**
+    * @function getPositions:
+    * @param S, a STORE 0 of the plan
+    * @param F, the current function
+    * @returns the instructions it runs right before once added, as the lifetime markers see them: the terminator of the block an edge comes from, each return
+    **/
+   std::vector<Instruction*> getPositions(const ScrubPlacement& S, Function& F){
+      std::vector<Instruction*> positions;
+      if(S.site == onEdge){
+	 positions.push_back(S.from->getTerminator());
+      }
+      else if(S.site == beforeReturns){
+	 for(BasicBlock &BB : F){
+	    if(isa<ReturnInst>(BB.getTerminator())){
+	       positions.push_back(BB.getTerminator());
+	    }
+	 }
+      }
+      else{
+	 positions.push_back(S.place);
+      }
+      return positions;
+   }
+
+   bool isAliveAt(const ScrubPlacement& S, AllocaInst* AI, Function& F){
+      for(Instruction* I : getPositions(S, F)){
+	 if(lifetimes.isAlive(AI, I)){
+	    return true;
+	 }
+      }
+      return false;
+   }
+
+   bool isStartedAt(const ScrubPlacement& S, AllocaInst* AI, Function& F){
+      for(Instruction* I : getPositions(S, F)){
+	 if(lifetimes.isStarted(AI, I)){
+	    return true;
+	 }
+      }
+      return false;
+   }
+
+   /**
+    * @function rescrub:
+    * plans at another place the same STORE 0 as the STORE 0 index of the plan: the same bytes of the variable are set to 0
+    * @param index, a STORE 0 of the plan
+    * @param AI, its variable
+    * @param place, the instruction or the STORE 0 before which the copy goes
+    * @returns nothing
+    *
+    **/
+   void rescrub(unsigned index, AllocaInst* AI, PlannedCode place){
+      if(place.isEnd()){
+	 return;
+      }
+      if(!place.isScrub() && (isa<PHINode>(place.instruction) || place.instruction->isEHPad())){
+	 place = getFirstInsertionCode(place.instruction->getParent());
+      }
+      ScrubPlacement S = plan[index];
+      S.trigger = place;
+      S.use = AI;
+      S.reason = reason.str();
+      planBefore(S, place);
+   }
+
+   /**
+    * @function remove_duplicate_scrubs:
+    * removes the STORE 0 instructions which put at 0 a variable that is already at 0 at this point of the block.
+    * It happens when the pass runs after inlining (LTO) on functions whose callees were already handled in their own translation unit:
+    * the STORE 0 of the inlined frame are then found right next to the ones we just added.
+    * Only the STORE 0 carrying !storm.scrub are erased: a volatile store of 0 written by the program only tells the variable is at 0.
+    * @param F the current function
+    * @returns nothing but the redundant STORE 0 are erased
+    *
+    **/
+   void remove_duplicate_scrubs(Function& F){
+      for(BasicBlock &BB : F){
+	 remove_duplicates(plan.getCode(&BB));
+	 std::vector<BasicBlock*> successors;
+	 for(auto it = succ_begin(&BB), end = succ_end(&BB); it != end; ++it){
+	    if(std::find(successors.begin(), successors.end(), *it) == successors.end()){//the block of a split edge
+	       successors.push_back(*it);
+	       remove_duplicates(getQueueCode(plan.getOnEdge(&BB, *it)));
+	    }
+	 }
+      }
+      remove_duplicates(getQueueCode(plan.getBeforeReturns()));//the block of the merged returns
+   }
+
+   std::vector<PlannedCode> getQueueCode(const std::vector<unsigned>& queue){
+      std::vector<PlannedCode> code;
+      for(unsigned index : queue){
+	 code.push_back(PlannedCode(nullptr, index));
+      }
+      return code;
+   }
+
+   /**
+    * @function remove_duplicates:
+    * @param code, the code of a block once the plan is applied
+    * @returns nothing but the STORE 0 planned there which are duplicates are dropped, the ones of the program are removed
+    **/
+   void remove_duplicates(const std::vector<PlannedCode>& code){
+      std::vector<Value*> atZero;//the variables known to be at 0 at the current point of the block
+      std::map<Value*, PlannedCode> zeroedBy;//the memset which set them to 0
+      for(PlannedCode C : code){
+	 if(C.isScrub()){
+	    const ScrubPlacement &S = plan[C.scrub];
+	    AllocaInst* AI = dyn_cast<AllocaInst>(S.address);
+	    if(S.type != nullptr){//a STORE 0 of the whole variable
+	       if(std::find(atZero.begin(), atZero.end(), AI) != atZero.end()){
+		  if(zeroedBy.count(AI) && !zeroedBy[AI].isScrub()){
+		     keep_program_scrub(cast<MemSetInst>(zeroedBy[AI].instruction), AI);
+		  }
+		  plan.drop(C.scrub);
+		  numSTORE0REMOVED++;
+	       }
+	       else{
+		  atZero.push_back(AI);
+	       }
+	    }
+	    else if(AI != nullptr && !isDynamicArray(AI) && S.offset == 0 && S.size >= AI->getModule()->getDataLayout().getTypeAllocSize(AI->getAllocatedType())){
+	       if(std::find(atZero.begin(), atZero.end(), AI) == atZero.end()){
+		  atZero.push_back(AI);
+	       }
+	       zeroedBy[AI] = C;
+	    }
+	    else{//a part of a variable, a dynamic array or a coroutine frame
+	       atZero.clear();
+	       zeroedBy.clear();
+	    }
+	    continue;
+	 }
+	 Instruction* I = C.instruction;
+	 if(MemSetInst* MSI = dyn_cast<MemSetInst>(I)){
+	    AllocaInst* AI = dyn_cast<AllocaInst>(MSI->getRawDest()->stripPointerCasts());
+	    if(AI != nullptr && getZeroingMemSet(MSI, AI) != nullptr){
+	       if(std::find(atZero.begin(), atZero.end(), AI) == atZero.end()){
+		  atZero.push_back(AI);
+	       }
+	       zeroedBy[AI] = C;
+	       continue;
+	    }
+	 }
+	 if(StoreInst* SI = dyn_cast<StoreInst>(I)){
+	    Value* V = SI->getPointerOperand();
+	    auto found = std::find(atZero.begin(), atZero.end(), V);
+	    if(SI->isVolatile() && isAStore0Inst(*SI) && isa<AllocaInst>(V)){
+	       if(found != atZero.end() && isTaggedScrub(SI)){//already at 0 and nothing wrote in it since, the volatile stores of the program stay
+		  if(zeroedBy.count(V) && !zeroedBy[V].isScrub()){
+		     keep_program_scrub(cast<MemSetInst>(zeroedBy[V].instruction), cast<AllocaInst>(V));
+		  }
+		  ScrubPlacement R;
+		  R.site = removedStore;
+		  R.place = SI;
+		  R.address = V;
+		  R.pass = "PutAtZero";
+		  R.reason = DuplicateScrubReason;
+		  plan.add(R);
+		  numSTORE0REMOVED++;
+	       }
+	       else if(found == atZero.end()){
+		  atZero.push_back(V);
+	       }
+	       continue;
+	    }
+	    if(found != atZero.end()){
+	       atZero.erase(found);
+	       zeroedBy.erase(V);
+	    }
+	    if(isa<AllocaInst>(V)){//a store in another variable cannot modify ours
+	       continue;
+	    }
+	 }
+	 if(I->mayWriteToMemory()){//calls, stores through pointers... might write in any variable whose address was taken
+	    atZero.clear();
+	    zeroedBy.clear();
+	 }
+      }
+   }
+
+   /**
+    * @function unify_returns:
+    * in optimized code, the block returning is not necessarily the last one and there might be several of them.
+    * Since the whole pass walks back from the last block, all the returns are merged in a single block moved at the end of the function.
+    * @param F, the current function
+    * @returns true if the CFG was modified (new return block)
+    *
+    **/
+   bool unify_returns(Function& F){
+      std::vector<BasicBlock*> returningBlocks;
+      for(BasicBlock &BB : F){
+	 if(isa<ReturnInst>(BB.getTerminator())){
+	    returningBlocks.push_back(&BB);
+	 }
+      }
+      if(returningBlocks.empty()){
+	 return false;
+      }
+      if(returningBlocks.size() == 1){
+	 returningBlocks[0]->moveAfter(&F.back());
+	 return false;
+      }
+      BasicBlock* returnBlock = BasicBlock::Create(F.getContext(), "paz.return", &F);
+      PHINode* PN = nullptr;
+      if(!F.getReturnType()->isVoidTy()){
+	 PN = PHINode::Create(F.getReturnType(), returningBlocks.size(), "paz.retval", returnBlock);
+      }
+      ReturnInst::Create(F.getContext(), PN, returnBlock);
+      for(BasicBlock* BB : returningBlocks){
+	 if(PN != nullptr){
+	    PN->addIncoming(BB->getTerminator()->getOperand(0), BB);
+	 }
+	 BB->getTerminator()->eraseFromParent();
+	 BranchInst::Create(returnBlock, BB);
+      }
+      return true;
+   }
+
+   /**
+    * @function demote_sensitive:
+    * once mem2reg and SROA ran, the sensitive variables (-paz-sensitive) might only live in registers and in the spill slots chosen by the backend, out of our reach.
+    * Their values (found with their llvm.dbg.value) are put back in a stack variable: each use reloads the value, and the variable is then handled like any other one.
+    * @param F, the current function
+    * @returns nothing but the sensitive values are demoted to the stack
+    *
+    **/
+   void demote_sensitive(Function& F){
+      if(PaZSensitive.empty()){
+	 return;
+      }
+      std::vector<Instruction*> toDemote;
+      std::vector<Argument*> argsToDemote;
+      for(BasicBlock &BB : F){
+	 for(Instruction &I : BB){
+	    DbgValueInst* DVI = dyn_cast<DbgValueInst>(&I);
+	    if(DVI == nullptr || std::find(PaZSensitive.begin(), PaZSensitive.end(), DVI->getVariable()->getName().str()) == PaZSensitive.end()){
+	       continue;
+	    }
+	    Value* V = DVI->getValue();
+	    if(Instruction* Ins = dyn_cast_or_null<Instruction>(V)){
+	       if(!isa<AllocaInst>(Ins) && std::find(toDemote.begin(), toDemote.end(), Ins) == toDemote.end()){
+		  toDemote.push_back(Ins);
+	       }
+	    }
+	    else if(Argument* A = dyn_cast_or_null<Argument>(V)){
+	       if(std::find(argsToDemote.begin(), argsToDemote.end(), A) == argsToDemote.end()){
+		  argsToDemote.push_back(A);
+	       }
+	    }
+	 }
+      }
+      for(Instruction* I : toDemote){
+	 if(DemoteRegToStack(*I, true) != nullptr){//volatile loads: the value must not be promoted again
+	    numDEMOTED++;
+	 }
+      }
+      for(Argument* A : argsToDemote){
+	 demote_argument(F, A);
+      }
+   }
+
+   /**
+    * @function demote_argument:
+    * same as DemoteRegToStack but for a function argument: it is stored in a new variable at the beginning of the function
+    * and each use reloads it from there.
+    * @param F, the current function
+    * @param A, the sensitive argument
+    * @returns nothing
+    *
+    **/
+   void demote_argument(Function& F, Argument* A){
+      std::vector<User*> users(A->user_begin(), A->user_end());
+      IRBuilder<> Builder(&*F.getEntryBlock().begin());
+      AllocaInst* slot = Builder.CreateAlloca(A->getType(), nullptr, A->getName() + ".paz");
+      Builder.CreateStore(A, slot);
+      for(User* U : users){
+	 Instruction* I = dyn_cast<Instruction>(U);
+	 if(I == nullptr || isa<DbgInfoIntrinsic>(I)){
+	    continue;
+	 }
+	 if(PHINode* PN = dyn_cast<PHINode>(I)){//the value is reloaded at the end of the incoming block
+	    for(unsigned i = 0; i < PN->getNumIncomingValues(); ++i){
+	       if(PN->getIncomingValue(i) == A){
+		  Builder.SetInsertPoint(PN->getIncomingBlock(i)->getTerminator());
+		  LoadInst* reload = Builder.CreateLoad(A->getType(), slot, A->getName() + ".reload");
+		  reload->setVolatile(true);
+		  PN->setIncomingValue(i, reload);
+	       }
+	    }
+	 }
+	 else{
+	    Builder.SetInsertPoint(I);
+	    LoadInst* reload = Builder.CreateLoad(A->getType(), slot, A->getName() + ".reload");
+	    reload->setVolatile(true);
+	    I->replaceUsesOfWith(A, reload);
+	 }
+      }
+      numDEMOTED++;
+   }
+
+   /**
+    * @function find_escaped:
+    * looks for the variables whose address is given to a function which might keep it (see CalleeSummary)
+    * their value might be read through this pointer at any time, so they are only set to 0 when leaving the function
+    * @param F, the current function
+    * @returns nothing but fills the escaped vector
+    *
+    **/
+   void find_escaped(Function& F){
+      escaped.clear();
+      for(BasicBlock &BB : F){
+	 for(Instruction &I : BB){
+	    if(CallInst* CI = dyn_cast<CallInst>(&I)){
+	       for(unsigned i = 0; i < getNumCallArgs(CI); ++i){
+		  AllocaInst* AI = dyn_cast<AllocaInst>(CI->getArgOperand(i)->stripInBoundsOffsets());
+		  if(AI != nullptr && !isDynamicArray(AI) && (summaries.getEffect(CI, i) & captures) && !isEscaped(AI)){
+		     escaped.push_back(AI);
+		  }
+	       }
+	    }
+	 }
+      }
+   }
+
+   bool isEscaped(AllocaInst* AI){
+      return std::find(escaped.begin(), escaped.end(), AI) != escaped.end();
+   }
+
+   /**
+    * @function kill_escaped:
+    * puts the escaped variables to 0 before each return of the function
+    * @param F, the current function
+    * @returns nothing
+    *
+    **/
+   void kill_escaped(Function& F){
+      reason = "return";
+      bool returns = false;
+      for(BasicBlock &BB : F){
+	 returns |= isa<ReturnInst>(BB.getTerminator());
+      }
+      if(escaped.empty() || !returns){
+	 return;
+      }
+      for(AllocaInst* AI : escaped){//the returns are merged when the plan is applied: the STORE 0 are not copied in each return
+	 ScrubPlacement S;
+	 if(getStore0(AI, S)){
+	    S.site = beforeReturns;
+	    S.use = AI;
+	    plan.add(S);
+	 }
+      }
+   }
+
+   /**
+    * @function getArrayArguments:
+    * @param CI a call instruction
+    * @returns the arrays and the structures whose address (or the address of one of their cases or fields) is given to the call and which are read or written by the callee
+    *
+    **/
+   std::vector<AllocaInst*> getArrayArguments(CallInst* CI){
+      std::vector<AllocaInst*> arrays;
+      for(unsigned i = 0; i < getNumCallArgs(CI); ++i){
+	 AllocaInst* AI = dyn_cast<AllocaInst>(CI->getArgOperand(i)->stripInBoundsOffsets());
+	 if(AI != nullptr && !isDynamicArray(AI) && AI->getAllocatedType()->isAggregateType() && summaries.getEffect(CI, i) != noEffect){//an array or a structure, as for the loads and the stores
+	    arrays.push_back(AI);
+	 }
+      }
+      return arrays;
+   }
+
+   /**
+    * @function getAccesses:
+    * lists the variables read or written by an instruction: a load, a store, a memory intrinsic or a call receiving the address of the variable
+    * the arrays (fixed or dynamic size) and the escaped variables are not listed since they are handled aside
+    * A write which does not cover the whole variable (a field of a structure, a memcpy of a part of it) keeps the rest of it alive: it counts as a read.
+    * @param I the current instruction
+    * @returns the variables accessed by I, each one with true if its value is read (it is alive before I), false if it is only written
+    *
+    **/
+   std::vector<std::pair<AllocaInst*, bool>> getAccesses(Instruction* I){
+      std::vector<std::pair<AllocaInst*, bool>> accesses;
+      if(isa<LoadInst>(I) || isa<StoreInst>(I)){
+	 Value* pointer = I->getOperand(I->getNumOperands() - 1);
+	 if(AllocaInst* AI = dyn_cast<AllocaInst>(pointer)){
+	    if(!isEscaped(AI) && !isDynamicArray(AI)){
+	       accesses.push_back(std::make_pair(AI, isa<LoadInst>(I)));
+	    }
+	 }
+	 else if(AllocaInst* AI = getTrackedVariable(pointer)){//a field, or the variable seen through a cast
+	    accesses.push_back(std::make_pair(AI, isa<LoadInst>(I) || !isWholeWrite(AI, pointer, getAccessSize(I))));
+	 }
+      }
+      else if(MemIntrinsic* MI = dyn_cast<MemIntrinsic>(I)){//llvm.memcpy, llvm.memmove, llvm.memset: the exact bytes are known
+	 if(MemTransferInst* MTI = dyn_cast<MemTransferInst>(MI)){
+	    if(AllocaInst* AI = getTrackedVariable(MTI->getRawSource())){
+	       accesses.push_back(std::make_pair(AI, true));
+	    }
+	 }
+	 if(AllocaInst* AI = getTrackedVariable(MI->getRawDest())){
+	    ConstantInt* length = dyn_cast<ConstantInt>(MI->getLength());
+	    bool whole = length != nullptr && isWholeWrite(AI, MI->getRawDest(), length->getZExtValue());
+	    accesses.push_back(std::make_pair(AI, !whole));
+	 }
+      }
+      else if(CallInst* CI = dyn_cast<CallInst>(I)){
+	 for(unsigned i = 0; i < getNumCallArgs(CI); ++i){
+	    Value* pointer = CI->getArgOperand(i);
+	    AllocaInst* AI = getTrackedVariable(pointer);//the variable, or one of its fields
+	    if(AI == nullptr){
+	       continue;
+	    }
+	    unsigned effect = summaries.getEffect(CI, i);
+	    if(effect != noEffect){//a callee which only might write (scanf, a conditional store) or writes a field keeps the old value alive
+	       const DataLayout &DL = AI->getModule()->getDataLayout();
+	       uint64_t size = DL.getTypeAllocSize(AI->getAllocatedType());
+	       bool kill = (effect & reads) == 0 && summaries.isMustWrite(CI, i, size) && isWholeWrite(AI, pointer, size);
+	       accesses.push_back(std::make_pair(AI, !kill));
+	    }
+	 }
+      }
+      return accesses;
+   }
+
+   /**
+    * @function getAccesses:
+    * @param C an instruction of the program or a STORE 0 of the plan
+    * @returns the variables accessed by C, as getAccesses(Instruction*) lists them: a STORE 0 writes its variable, all of it or a part (read)
+    **/
+   std::vector<std::pair<AllocaInst*, bool>> getAccesses(PlannedCode C){
+      if(C.isEnd()){
+	 return std::vector<std::pair<AllocaInst*, bool>>();
+      }
+      if(!C.isScrub()){
+	 return getAccesses(C.instruction);
+      }
+      std::vector<std::pair<AllocaInst*, bool>> accesses;
+      const ScrubPlacement &S = plan[C.scrub];
+      AllocaInst* AI = dyn_cast<AllocaInst>(S.address);
+      if(AI == nullptr || isDynamicArray(AI) || isEscaped(AI)){
+	 return accesses;
+      }
+      if(S.type != nullptr){//a store of the whole variable
+	 accesses.push_back(std::make_pair(AI, false));
+      }
+      else if(!AI->getAllocatedType()->isAggregateType()){
+	 const DataLayout &DL = AI->getModule()->getDataLayout();
+	 accesses.push_back(std::make_pair(AI, !(S.offset == 0 && S.size >= DL.getTypeAllocSize(AI->getAllocatedType()))));
+      }
+      return accesses;
+   }
+
+   /**
+    * @function getTrackedVariable:
+    * @param pointer an address
+    * @returns the variable it points into, when the last use analysis handles it (not an array nor a structure, which array_handler sets to 0 by ranges, not escaped), nullptr otherwise
+    **/
+   AllocaInst* getTrackedVariable(Value* pointer){
+      AllocaInst* AI = dyn_cast<AllocaInst>(pointer->stripInBoundsOffsets());
+      if(AI == nullptr || AI->getAllocatedType()->isAggregateType() || isDynamicArray(AI) || isEscaped(AI)){
+	 return nullptr;
+      }
+      return AI;
+   }
+
+   /**
+    * @function isWholeWrite:
+    * @param AI a variable
+    * @param pointer the address written
+    * @param size the number of bytes written
+    * @returns true if all the bytes of AI are overwritten
+    **/
+   bool isWholeWrite(AllocaInst* AI, Value* pointer, uint64_t size){
+      const DataLayout &DL = AI->getModule()->getDataLayout();
+      return pointer->stripPointerCasts() == AI && size >= DL.getTypeAllocSize(AI->getAllocatedType());
+   }
+
+   /**
+    * @function getAccessSize:
+    * @param I a load or a store
+    * @returns the number of bytes it reads or writes
+    **/
+   uint64_t getAccessSize(Instruction* I){
+      const DataLayout &DL = I->getModule()->getDataLayout();
+      Type* type = isa<LoadInst>(I) ? I->getType() : I->getOperand(0)->getType();
+      return DL.getTypeStoreSize(type);
    }
 
    /**
-    * @function array_handler:
-    * handle array which are some "weird variables" and put a 0 in all their cases after the "last use" (last access to an array case)
-    * @param F the current running function
-    * @param dominator_blocks, the vector containing all the dominators
-    * @param DT the dominator tree, for method calling purposes
-    * @returns: nothing but the arrays are handled in a way such as if they were variables
-    *
+    * @function getZeroingMemSet:
+    * @param I an instruction
+    * @param AI a variable
+    * @returns I if it is a memset setting all the bytes of AI to 0, nullptr otherwise
     **/
-   void array_handler(Function& F, std::vector<BasicBlock*> &dominator_blocks, DominatorTree& DT){
-      std::vector<AllocaInst*> atZeroArrays;//arrays already to 0
-      BasicBlock* BB = &F.back();
-      while(BB != nullptr){
-	 Instruction* I = BB->getTerminator();
-	 while(I != nullptr){//we iterate over the instructions from the last one to the first one to find any array access (opcode 32)
-	    if(I->getOpcode() == 32){
-	       if(AllocaInst* AI = dyn_cast<AllocaInst>(I->getOperand(0))){//we check that it access a 
-		  if(std::find(atZeroArrays.begin(), atZeroArrays.end(), AI) == atZeroArrays.end()){
-   		     dead_array(I, dominator_blocks, DT);
-   		     atZeroArrays.push_back(AI);
-		  }
-	       }
-	    }
-	    I = I->getPrevNode();
-	 }
-	 BB = BB->getPrevNode();
+   MemSetInst* getZeroingMemSet(Instruction* I, AllocaInst* AI){
+      MemSetInst* MSI = dyn_cast<MemSetInst>(I);
+      if(MSI == nullptr){
+	 return nullptr;
+      }
+      ConstantInt* value = dyn_cast<ConstantInt>(MSI->getValue());
+      ConstantInt* length = dyn_cast<ConstantInt>(MSI->getLength());
+      if(value == nullptr || !value->isZero() || length == nullptr || !isWholeWrite(AI, MSI->getRawDest(), length->getZExtValue())){
+	 return nullptr;
       }
+      return MSI;
    }
 
    /**
-    * @function dead_array:
-    * properly set all the cases to zero once the array is dead
-    * @param I, the last Instruction using the variable
-    * @param dominators, the dominators
-    * @param DT, the dominatorTree for method purposes
-    * @returns nothing but the array is put to 0 once and for all
-    *
+    * @function keep_program_scrub:
+    * a memset to 0 written in the program already sets the variable to 0: it replaces our STORE 0.
+    * It is made volatile when the plan is applied (addProgramScrub), so that the dead store elimination does not remove it.
+    * @param MSI the memset of the program
+    * @param AI the variable it sets to 0
+    * @returns nothing
     **/
-   void dead_array(Instruction* I, std::vector<BasicBlock*> &dominators, DominatorTree &DT){
-   	 BasicBlock* BB = getFirstDom(dominators, I->getParent(), DT);
-	 Instruction* place = I->getNextNode();
-	 if(BB != I->getParent()){
-	    place = &BB->front();
+   void keep_program_scrub(MemSetInst* MSI, AllocaInst* AI){
+      if(MSI->isVolatile()){//already one of ours, or already kept
+	 return;
+      }
+      for(unsigned i = 0; i < plan.size(); ++i){
+	 if(!plan[i].dropped && plan[i].site == programMemSet && plan[i].place == MSI){
+	    return;
 	 }
-	    addStore0(*I, I->getOperand(0), place);
+      }
+      ScrubPlacement S;
+      S.site = programMemSet;
+      S.place = MSI;
+      S.address = AI;
+      S.trigger = PlannedCode(MSI);
+      S.pass = "PutAtZero";
+      S.reason = ProgramScrubReason;
+      plan.add(S);
    }
 
    /**
-    * @function kill_unreachables:
-    * put all the variables to the 0 value (regardless of both their type and current value) in all the "dead end" blocks to insure that everything is back to normal at any exit of the function.
-    * @param unreachables, a vector with all the blocks containing an unreachable instruction.
-    * @param F, the current function
-    * @returns nothing but sets all the variable used in all the function to 0
-    *
+    * @function addProgramScrub:
+    * @param S a memset of the program kept by keep_program_scrub
+    * @returns nothing but the memset is made volatile and tagged
     **/
+   void addProgramScrub(const ScrubPlacement& S){
+      MemSetInst* MSI = cast<MemSetInst>(S.place);
+      if(MSI->isVolatile()){
+	 return;
+      }
+      MSI->setVolatile(ConstantInt::getTrue(MSI->getContext()));
+      tagScrub(MSI, S.address, "PutAtZero", MSI, ProgramScrubReason);
+      programScrubs.push_back(MSI);//not in scrubs: it is part of the program
+      numPROGRAMSCRUBS++;
+   }
 
-   void kill_unreachables(std::vector<BasicBlock*> unreachables, Function& F){
-      BasicBlock* firstBlock = &F.front();
-      for(auto it = unreachables.begin(), end = unreachables.end(); it != end; ++it){
-	 for(Instruction& I : *firstBlock){
-	    if(AllocaInst* AI = dyn_cast<AllocaInst>(&I)){
-	       addStore0(I, AI, &(*it)->front());
-	    }
+   /**
+    * @function isWriteOf:
+    * @returns true if I (an instruction or a STORE 0 of the plan) only writes the variable AI
+    **/
+   bool isWriteOf(PlannedCode I, AllocaInst* AI){
+      for(auto access : getAccesses(I)){
+	 if(access.first == AI && !access.second){
+	    return true;
 	 }
       }
+      return false;
    }
 
    void initialize(Function& F){
+      reason = "entry";
       BasicBlock* firstBlock = &F.front();
       for(Instruction& I : *firstBlock){
-	 if(AllocaInst* AI = dyn_cast<AllocaInst>(&I)){
-	    addStore0(I, AI);
+	 AllocaInst* AI = dyn_cast<AllocaInst>(&I);
+	 if(AI != nullptr && !isDynamicArray(AI)){
+	    planStore0(PlannedCode(&I), AI);
 	 }
       }
    }
@@ -323,10 +2736,11 @@ namespace {
     *
     **/
    void loop_handler(InstructionList &iList, BlockList &bList, Loop* loop){
-      LoopInfo& loopData = getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
+      PhaseScope phase(timers, "loop_handler", *loop->getHeader()->getParent());//the time of the inner loops is included
+      LoopInfo& loopData = *loopInfo;
       std::list<BasicBlock*> toTreat;
       toTreat.push_back(loop->getHeader());
-      while(!toTreat.empty()){
+      while(!toTreat.empty() && spend()){
    	 BasicBlock* BB = toTreat.front();
 	 if(loopData.getLoopFor(BB) != loop){
 	    loop_handler(iList, bList, loopData.getLoopFor(BB));
@@ -375,51 +2789,50 @@ namespace {
     *
     **/
    void partial_treat(BasicBlock* BB){//technically only for loop blocks
-      std::vector<std::pair<std::pair<AllocaInst*, int>, Instruction*>> varia_vect;
-      Instruction* I = BB->getTerminator();
-      while(I != nullptr){
-	 bool found = false;
-	 if(LoadInst* LI = dyn_cast<LoadInst>(I)){
-	    if(AllocaInst* AI = dyn_cast<AllocaInst>(LI->getOperand(0))){
+      std::vector<std::pair<std::pair<AllocaInst*, int>, PlannedCode>> varia_vect;
+      std::vector<PlannedCode> code = plan.getCode(BB);//with the STORE 0 planned so far
+      for(auto itCode = code.rbegin(), itCode_end = code.rend(); itCode != itCode_end; ++itCode){
+	 PlannedCode I = *itCode;
+	 for(auto access : getAccesses(I)){//loads, stores and calls receiving the address of a variable
+	    AllocaInst* AI = access.first;
+	    bool found = false;
+	    if(access.second){//the value is read
    	       for(auto it = varia_vect.begin(), it_end = varia_vect.end(); it != it_end; it++){
    		  if((*it).first.first == AI){
-		     if((*it).first.second > 0 && (*it).second->getOpcode() == 31){
-			addStore0(*LI);
+		     if((*it).first.second > 0 && isWriteOf((*it).second, AI)){
+			planStore0(I, AI);
 		     }
-   		     (*it).second = LI;
+   		     (*it).second = I;
    		     found = true;
    		     break;
    		  }
    	       }
    	       if(!found){
-   		  std::pair<std::pair<AllocaInst*, int>, Instruction*> new_var;
+   		  std::pair<std::pair<AllocaInst*, int>, PlannedCode> new_var;
    		  new_var.first.first = AI;
    		  new_var.first.second = 0;
-   		  new_var.second = LI;
+   		  new_var.second = I;
    		  varia_vect.push_back(new_var);
    	       }
 	    }
-	 }
-	 if(StoreInst* SI = dyn_cast<StoreInst>(I)){
-	    if(AllocaInst* AI = dyn_cast<AllocaInst>(SI->getOperand(1))){
+	    else{//the value is overwritten
 	       for(auto it = varia_vect.begin(), it_end = varia_vect.end(); it != it_end; it++){
 		  if((*it).first.first == AI){
 		     ((*it).first.second)++;
 		     found = true;
-		     (*it).second = SI;
+		     (*it).second = I;
 		     break;
 		  }
 	       }
 	       if(!found){
-		  std::pair<std::pair<AllocaInst*, int>, Instruction*> new_var;
+		  std::pair<std::pair<AllocaInst*, int>, PlannedCode> new_var;
 		  new_var.first.first = AI;
 		  new_var.first.second = 1;
-		  new_var.second = SI;
+		  new_var.second = I;
 		  varia_vect.push_back(new_var);
 	       }
 	    }
 	 }
-	 I = I->getPrevNode();
       }
    }
 
@@ -477,6 +2890,162 @@ namespace {
       }
    }
 
+   /**
+    * @function clone_switchable:
+    * copies the functions selected by -paz-switchable, the paz_switchable annotation or the "paz-switchable" attribute before any STORE 0 is added:
+    * the copy <name>.paz.plain is left untouched by the pass.
+    * A function not read yet from the bitcode (paz-batch -lazy) is read first, the copy needs its body
+    * @param M the current module
+    * @returns nothing but plainClones is filled
+    **/
+   void clone_switchable(Module& M){
+      plainClones.clear();
+      std::set<Function*> selected;
+      for(Function &F : M){
+	 if(F.hasFnAttribute("paz-switchable") || std::find(PaZSwitchable.begin(), PaZSwitchable.end(), F.getName().str()) != PaZSwitchable.end()){
+	    selected.insert(&F);
+	 }
+      }
+      for(auto &annotation : getGlobalAnnotations(M)){
+	 if(isa<Function>(annotation.first) && annotation.second == "paz_switchable"){
+	    selected.insert(cast<Function>(annotation.first));
+	 }
+      }
+      for(Function* F : selected){
+	 if(F->isDeclaration() || std::find(PaZSkip.begin(), PaZSkip.end(), F->getName().str()) != PaZSkip.end()){
+	    continue;
+	 }
+	 if(F->isVarArg()){//the arguments could not be forwarded to the copy
+	    errs() << "\033[0;31m-paz-switchable: " << F->getName() << " takes variable arguments, it is always scrubbed\033[0;0m\n";
+	    continue;
+	 }
+	 if(F->isMaterializable()){
+#if LLVM_VERSION_MAJOR >= 4
+	    Error E = F->materialize();
+	    std::string message = E ? toString(std::move(E)) : "";
+#else
+	    std::error_code EC = F->materialize();
+	    std::string message = EC ? EC.message() : "";
+#endif
+	    if(!message.empty()){
+	       errs() << "\033[0;31m-paz-switchable: the body of " << F->getName() << " could not be read (" << message << "), it is always scrubbed\033[0;0m\n";
+	       continue;
+	    }
+	 }
+	 ValueToValueMapTy VMap;
+	 Function* plain = CloneFunction(F, VMap);
+	 plain->setName(F->getName() + ".paz.plain");
+	 plain->setLinkage(GlobalValue::InternalLinkage);
+	 plain->setComdat(nullptr);
+	 plainClones[F] = plain;
+      }
+   }
+
+   /**
+    * @function quarantine_frees:
+    * redirects the calls to free (and its address taken as a function pointer) to __paz_free:
+    * the runtime sets the buffer to 0 before freeing it, the large buffers in the background.
+    * The functions not read yet from the bitcode (paz-batch -lazy) still call free: they are redirected by runOnFunction
+    * @param M the current module
+    * @returns the number of uses of free redirected
+    **/
+   int quarantine_frees(Module& M){
+      quarantinedFree = std::make_pair(nullptr, nullptr);
+      Function* freeFn = M.getFunction("free");
+      if(freeFn == nullptr || !freeFn->isDeclaration() || freeFn->arg_size() != 1 || !freeFn->getReturnType()->isVoidTy()){//free of an allocator defined in the module
+	 return 0;
+      }
+      quarantinedFree = std::make_pair(freeFn, getRuntimeFunction(M, "__paz_free", freeFn->getFunctionType()));
+      int uses = freeFn->getNumUses();
+      freeFn->replaceAllUsesWith(quarantinedFree.second);
+      return uses;
+   }
+
+   /**
+    * @function countUses:
+    * @param F a function
+    * @param V a value
+    * @returns the number of operands of the instructions of F which are V
+    **/
+   int countUses(Function& F, Value* V){
+      int uses = 0;
+      for(BasicBlock &BB : F){
+	 for(Instruction &I : BB){
+	    for(Value* operand : I.operand_values()){
+	       uses += operand == V;
+	    }
+	 }
+      }
+      return uses;
+   }
+
+   /**
+    * @function isPlainClone:
+    * @param F a function of the module
+    * @returns true if F is the copy without STORE 0 of a switchable function
+    **/
+   bool isPlainClone(Function& F){
+      for(auto &clone : plainClones){
+	 if(clone.second == &F){
+	    return true;
+	 }
+      }
+      return false;
+   }
+
+   /**
+    * @function add_dispatch:
+    * puts a block in front of a scrubbed function which goes on with it when __paz_scrub_enabled is set (ScrubRuntime)
+    * and calls its plain copy otherwise: a load and a branch which always goes the same way
+    * @param F the switchable function, already handled by the pass
+    * @param plain its copy without STORE 0
+    * @returns nothing
+    **/
+   void add_dispatch(Function& F, Function* plain){
+      Module &M = *F.getParent();
+      LLVMContext &Ctx = F.getContext();
+      Type* i32 = Type::getInt32Ty(Ctx);
+      GlobalVariable* enabled = M.getNamedGlobal("__paz_scrub_enabled");
+      if(enabled == nullptr){
+	 enabled = new GlobalVariable(M, i32, false, GlobalValue::ExternalLinkage, nullptr, "__paz_scrub_enabled");
+      }
+      BasicBlock* scrubbed = &F.getEntryBlock();
+      BasicBlock* dispatch = BasicBlock::Create(Ctx, "paz.dispatch", &F, scrubbed);
+      BasicBlock* unscrubbed = BasicBlock::Create(Ctx, "paz.plain", &F, scrubbed);
+      //the allocas stay in the entry block: out of it they would be dynamic
+      std::vector<AllocaInst*> allocas;
+      for(Instruction &I : *scrubbed){
+	 if(AllocaInst* AI = dyn_cast<AllocaInst>(&I)){
+	    if(isa<ConstantInt>(AI->getArraySize())){
+	       allocas.push_back(AI);
+	    }
+	 }
+      }
+      for(AllocaInst* AI : allocas){
+	 AI->moveBefore(*dispatch, dispatch->end());
+      }
+      IRBuilder<> Builder(dispatch);
+      Value* flag = Builder.CreateLoad(enabled->getValueType(), enabled, "paz.enabled");
+      Builder.CreateCondBr(Builder.CreateICmpNE(flag, ConstantInt::get(i32, 0)), scrubbed, unscrubbed);
+
+      Builder.SetInsertPoint(unscrubbed);
+      std::vector<Value*> args;
+      for(Argument &A : F.args()){
+	 args.push_back(&A);
+      }
+      CallInst* CI = Builder.CreateCall(plain, args);
+      CI->setCallingConv(F.getCallingConv());
+      CI->setAttributes(F.getAttributes());
+      CI->setTailCall();
+      if(F.getReturnType()->isVoidTy()){
+	 Builder.CreateRetVoid();
+      }
+      else{
+	 Builder.CreateRet(CI);
+      }
+      numSWITCHABLE++;
+   }
+
    /**
     * @function override llvm::getAnalysisUsage:
     * this function allows us to get and use LoopInfo
@@ -486,6 +3055,7 @@ namespace {
    virtual void getAnalysisUsage(AnalysisUsage& AU) const override{
       AU.addRequired<LoopInfoWrapperPass>();
       AU.addRequired<DominatorTreeWrapperPass>();
+      AU.addRequired<TargetLibraryInfoWrapperPass>();
    }
 
    /**
@@ -496,9 +3066,16 @@ namespace {
     * @returns true if the 
     **/
    bool isAtZeroAtTheEnd(BasicBlock* BB, Value* V){
-      Instruction* I = BB->getTerminator();
-      while(I != nullptr){
-	 if(I->getOpcode() == 31 && I->getOperand(1) == V){
+      std::vector<PlannedCode> code = plan.getCode(BB);
+      for(auto it = code.rbegin(), end = code.rend(); it != end; ++it){
+	 if(it->isScrub()){
+	    if(plan[it->scrub].type != nullptr && plan[it->scrub].address == V){
+	       return true;
+	    }
+	    continue;
+	 }
+	 Instruction* I = it->instruction;
+	 if(I->getOpcode() == Instruction::Store && I->getOperand(1) == V){
 	    if(Constant* C = dyn_cast<Constant>(I->getOperand(0))){
 	       if(C->isNullValue()){
 		  return true;
@@ -506,11 +3083,11 @@ namespace {
 	    }
 	    return false;
 	 }
-	 if(I->getOpcode() == 30 && I->getOperand(0) == V){
+	 if(I->getOpcode() == Instruction::Load && I->getOperand(0) == V){
 	    return false;
 	 }
-	 I = I->getPrevNode();
       }
+      return false;
    }
 
    /**
@@ -526,61 +3103,46 @@ namespace {
    void setD(InstructionList& iList, BasicBlock* BB, bool isLoopHeader, BasicBlock* firstDominatorBlock = nullptr){
       if(isLoopHeader){
 	 firstDominatorBlock = &BB->getParent()->back();
-	 Instruction* I = BB->getTerminator();
-	 while(I != nullptr){
-   	    bool found = false;
-   	    if(I->getOpcode() == 30){
-	       if(AllocaInst* AI = dyn_cast<AllocaInst>(I->getOperand(0))){
-   		  for(int k = 0; k < iList[BB].size(); ++k){
-   		     if(iList[BB][k].first == AI){
-   			iList[BB][k].second = false;
-   			found = true;
-   		     }
-   		  }
-   		  if(!found){
-   		     IsDead varia;
-   		     varia.first = AI;
-   		     varia.second = false;
-   		     iList[BB].push_back(varia);
-		     if(!isAtZeroAtTheEnd(firstDominatorBlock, AI)){
-			addStore0(*I, I->getOperand(I->getNumOperands() - 1), &firstDominatorBlock->front());
-		     }
+	 std::vector<PlannedCode> code = plan.getCode(BB);//with the STORE 0 planned so far
+	 for(auto itCode = code.rbegin(), itCode_end = code.rend(); itCode != itCode_end; ++itCode){
+	    PlannedCode I = *itCode;
+	    for(auto access : getAccesses(I)){
+	       AllocaInst* AI = access.first;
+   	       bool found = false;
+   	       for(int k = 0; k < iList[BB].size(); ++k){
+   		  if(iList[BB][k].first == AI){
+   		     iList[BB][k].second = !access.second;//alive before a read, dead before a write
+   		     found = true;
    		  }
    	       }
-	    }
-	    if(I->getOpcode() == 31){
-	       if(AllocaInst *AI = dyn_cast<AllocaInst>(I->getOperand(1))){
-   		  for(int k = 0; k < iList[BB].size(); ++k){
-   		     if(iList[BB][k].first == AI){
-   			iList[BB][k].second = true;
-   			found = true;
-   		     }
-   		  }
-   		  if(!found){
-   		     IsDead varia;
-   		     varia.first = AI;
-  		     varia.second = true;
-   		     iList[BB].push_back(varia);
-		     if(!isAtZeroAtTheEnd(firstDominatorBlock, AI)){
-   			addStore0(*I, I->getOperand(I->getNumOperands() - 1), &firstDominatorBlock->front());
-		     }
-   		  }
+   	       if(!found){
+   		  IsDead varia;
+   		  varia.first = AI;
+   		  varia.second = !access.second;
+   		  iList[BB].push_back(varia);
+		  if(!isAtZeroAtTheEnd(firstDominatorBlock, AI)){
+		     planStore0(I, AI, plan.getCode(firstDominatorBlock).front());
+		  }
    	       }
 	    }
-	    I = I->getPrevNode();
 	 }
       }
       else{
-	 Instruction* I = BB->getTerminator();
-	 while(I != nullptr){
-	    if(I->getOpcode() == 30 || I->getOpcode() == 31){
-	       if(AllocaInst* AI = dyn_cast<AllocaInst>(I->getOperand(I->getNumOperands() - 1))){
-	 	  if(setter(iList, AI, I, BB, firstDominatorBlock) && !isAStore0Inst(*I) && !isAStore0Inst(*(I->getNextNode()))){
-	 	     addStore0(*I);
+	 std::vector<PlannedCode> code = plan.getCode(BB);//with the STORE 0 planned so far
+	 for(auto itCode = code.rbegin(), itCode_end = code.rend(); itCode != itCode_end; ++itCode){
+	    PlannedCode I = *itCode;
+	    for(auto access : getAccesses(I)){
+	       AllocaInst* AI = access.first;
+	       if(setter(iList, AI, I, access.second, BB, firstDominatorBlock) && !isAStore0Inst(I) && !isAStore0Inst(plan.getNext(I))){
+		  MemSetInst* MSI = I.isScrub() ? nullptr : getZeroingMemSet(I.instruction, AI);
+		  if(MSI != nullptr){//the program sets the variable to 0 itself
+		     keep_program_scrub(MSI, AI);
+		  }
+		  else{
+		     planStore0(I, AI);
 		  }
 	       }
 	    }
-	    I = I->getPrevNode();
 	 }
       }
    }
@@ -590,45 +3152,36 @@ namespace {
     * modifies the boolean status (if necessary) and returns information over it
     * @param iList, the Variable with their status in each block
     * @param AI, the Allocation Instruction which represents the variable
-    * @param I, the current instruction
+    * @param I, the current instruction (or STORE 0 of the plan)
+    * @param isRead, true if I reads the value of the variable (load, call reading the pointed value), false if it only writes it
     * @param BB, the current BasicBlock
     * @param firstDominatorBlock, the first Dominator block after BB (or BB if BB is a dominator)
     * @returns true if the variable is dead after instruction I and is to be set at 0
     *
     **/
-   bool setter(InstructionList &iList, AllocaInst* AI, Instruction *I, BasicBlock* BB, BasicBlock* firstDominatorBlock){
+   bool setter(InstructionList &iList, AllocaInst* AI, PlannedCode I, bool isRead, BasicBlock* BB, BasicBlock* firstDominatorBlock){
       for(int k = 0; k < iList[BB].size(); ++k){
 	 if(iList[BB][k].first == AI){
 	    if(iList[BB][k].second){
-	       if(I->getOpcode() == 30){
+	       if(isRead){
 		  iList[BB][k].second = false;
 	       }
 	       return true;
 	    }
 	    else{
-	       if(I->getOpcode() == 31){
+	       if(!isRead){
 		  iList[BB][k].second = true;
 	       }
 	       return false;
 	    }
 	 }
       }
-      if(I->getOpcode() == 30){
-	 AllocaInst* AI = dyn_cast<AllocaInst>(I->getOperand(0));
-	 IsDead varia;
- 	 varia.first = AI;
-	 varia.second = false;
-	 iList[BB].push_back(varia);
-      }
-      else{
-	 AllocaInst* AI = dyn_cast<AllocaInst>(I->getOperand(1));
-	 IsDead varia;
-	 varia.first = AI;
-	 varia.second = true;
-	 iList[BB].push_back(varia);
-      }
-      if(BB != firstDominatorBlock && !isAtZeroAtTheEnd(firstDominatorBlock, I->getOperand(I->getNumOperands() - 1))){
-	 addStore0(*I, I->getOperand(I->getNumOperands() - 1), &firstDominatorBlock->front());
+      IsDead varia;
+      varia.first = AI;
+      varia.second = !isRead;
+      iList[BB].push_back(varia);
+      if(BB != firstDominatorBlock && !isAtZeroAtTheEnd(firstDominatorBlock, AI)){
+	 planStore0(I, AI, plan.getCode(firstDominatorBlock).front());
       }
       return true;
    }
@@ -640,7 +3193,7 @@ namespace {
     * @returns true if the instruction was a Store 0, false elsewhere
     **/
    bool isAStore0Inst(Instruction &I){
-      if(I.getOpcode() == 31){
+      if(I.getOpcode() == Instruction::Store){
     	 if(Constant *C = dyn_cast<Constant>(I.getOperand(0))){
   	    if(C->isNullValue()){
   	       return true;
@@ -650,101 +3203,304 @@ namespace {
       return false;
    }
 
-
+   bool isAStore0Inst(PlannedCode C){
+      if(C.isScrub()){
+	 return plan[C.scrub].type != nullptr;
+      }
+      return !C.isEnd() && isAStore0Inst(*C.instruction);
+   }
 
    /**
-    * @function addStore0
-    * adds a store 0 of the Value V, before the instruction Iplace.
-    * in debug mode, it tries to display where in the source code it decided to add this store 0 instruction.
-    * @param I, the instruction with all the data we need
-    * @param V, the Value containing the type of store 0 we want (default, the value accessed by I)
-    * @param Iplace, the instruction before which we want to add a store 0 instruction (default, before the instruction following I)
-    * @returns nothing but
-    * @postcond a Store 0 instruction was added before Iplace or right after I
-    *
+    * @function getStore0:
+    * @param AI, a variable
+    * @param S, filled with the STORE 0 of the whole variable (the site and the place are left to the caller)
+    * @returns false if the type of AI cannot be set to 0 with a store, or if AI keeps an exception
     **/
-
-   void addStore0(Instruction &I, Value* V = nullptr, Instruction *Iplace = nullptr){
-      Instruction *NextI = Iplace;
-      if(NextI == nullptr){
-	 NextI = I.getNextNode();
-      }
-      if(V == nullptr){
-	 V = I.getOperand(I.getNumOperands() - 1);
-      }
-      if(NextI == nullptr){
-	 return;
-      }
-      AllocaInst* AI = nullptr;
-      IRBuilder<> Builder(NextI);
-      StoreInst* Store0 =  nullptr;
-      int ID = 0;
-
-      if(I.getOpcode() == 30 || I.getOpcode() == 32){
-	 AI = dyn_cast<AllocaInst>(I.getOperand(0));
+   bool getStore0(AllocaInst* AI, ScrubPlacement& S){
+      if(isExceptionSlot(AI)){//the resume exits reload the exception and its selector, they are never set to 0
+	 return false;
       }
-      else{
-	 if(AI = dyn_cast<AllocaInst>(&I)){
-	 }
-	 else{
-   	    AI = dyn_cast<AllocaInst>(I.getOperand(1));
-	 }
+      S.address = AI;
+      S.pass = "PutAtZero";
+      S.reason = reason.str();
+      if(isDynamicArray(AI)){//a single memset of the whole array, its size is computed where it is set to 0
+	 S.type = nullptr;
+	 S.size = 0;
+	 return true;
       }
-      ID = AI->getType()->getElementType()->getTypeID();
-      switch (ID) {//each case allows to check the type and store 0 type get<Typename>Ty at @operand with volatile=true in order to survive other pass
-
+      switch(AI->getAllocatedType()->getTypeID()){//a volatile store of the null value of the type, in order to survive the other passes
 	 case Type::IntegerTyID:
-	    Store0 = Builder.CreateStore(ConstantInt::get(Builder.getIntNTy(cast<IntegerType>(AI->getType()->getElementType())->getBitWidth()), 0), AI, true);
-	    break;
-		 
 	 case Type::FloatTyID:
-	    Store0 = Builder.CreateStore(ConstantFP::get(Builder.getFloatTy(), 0), V, true);
-	    break;
-
 	 case Type::DoubleTyID:
-	    Store0 = Builder.CreateStore(ConstantFP::get(Builder.getDoubleTy(), 0), V, true);
-	    break;
-
 	 case Type::HalfTyID:
-	    Store0 = Builder.CreateStore(ConstantFP::get(Builder.getHalfTy(), 0), V, true);
-	    break;
-		    
 	 case Type::FP128TyID:
-	    Store0 = Builder.CreateStore(ConstantFP::get(Type::getFP128Ty(Builder.getContext()), 0), V, true);
-	    break;
-		    
 	 case Type::X86_FP80TyID:
-	    Store0 = Builder.CreateStore(ConstantFP::get(Type::getX86_FP80Ty(Builder.getContext()), 0), V, true);
-	    break;
-
 	 case Type::PPC_FP128TyID:
-	    Store0 = Builder.CreateStore(ConstantFP::get(Type::getPPC_FP128Ty(Builder.getContext()), 0), V, true);
-	    break;
+	 case Type::PointerTyID:
+	 case Type::StructTyID://left in memory by SROA in optimized code
+	 case Type::ArrayTyID:
+	    S.type = AI->getAllocatedType();
+	    return true;
+	 default:
+	    errs() << "can't do my stuff, type too complex\n";
+	    return false;
+      }
+   }
 
-	 case Type::X86_MMXTyID:
-	    Store0 = Builder.CreateStore(ConstantFP::get(Type::getX86_MMXTy(Builder.getContext()), 0), V, true);
-	    break;
+   /**
+    * @function planStore0:
+    * plans a STORE 0 of the variable AI, before next.
+    * @param I, the instruction (or STORE 0 of the plan) which made it necessary, the variable itself for an exit
+    * @param AI, the variable
+    * @param next, the instruction or the STORE 0 before which it goes
+    * @returns its index in the plan, -1 if nothing is planned
+    *
+    **/
+   int planStore0(PlannedCode I, AllocaInst* AI, PlannedCode next){
+      if(next.isEnd()){
+	 return -1;
+      }
+      if(!next.isScrub() && (isa<PHINode>(next.instruction) || next.instruction->isEHPad())){//nothing can be put before the phi nodes and landing pads of a block
+	 next = getFirstInsertionCode(next.instruction->getParent());
+      }
+      ScrubPlacement S;
+      if(next.isEnd() || !getStore0(AI, S)){
+	 return -1;
+      }
+      S.trigger = I.instruction != nullptr && isa<AllocaInst>(I.instruction) ? next : I;//the use, or the exit when only the variable is given
+      S.use = I.instruction;
+      return planBefore(S, next);
+   }
 
-	 case Type::PointerTyID:
-	    Store0 = Builder.CreateStore(Constant::getNullValue(cast<PointerType>(AI->getType()->getElementType())), AI, true);
-	    break;
+   //right after I
+   int planStore0(PlannedCode I, AllocaInst* AI){
+      return planStore0(I, AI, plan.getNext(I));
+   }
 
-	 case Type::ArrayTyID:
-	    ArrayType* array = dyn_cast<ArrayType>(AI->getType()->getElementType());
-	    Store0 = Builder.CreateStore(Constant::getNullValue(array), AI, true);
-	    break;
+   /**
+    * @function planBefore:
+    * @param S, a STORE 0
+    * @param next, the instruction or the STORE 0 of the plan it precedes
+    * @returns its index in the plan
+    **/
+   int planBefore(ScrubPlacement& S, PlannedCode next){
+      if(next.isScrub()){
+	 S.site = plan[next.scrub].site;
+	 S.place = plan[next.scrub].place;
+	 S.from = plan[next.scrub].from;
+	 return plan.addBefore(next.scrub, S);
       }
-      if(Store0 == nullptr){
-	 errs() << "can't do my stuff, type too complex\n";
+      S.site = beforeInstruction;
+      S.place = next.instruction;
+      return plan.add(S);
+   }
+
+   /**
+    * @function planOnEdge:
+    * plans a STORE 0 of AI on the edge from -> to, the edge is split when the plan is applied
+    * @param AI, the variable
+    * @param from, a block
+    * @param to, one of its successors
+    * @returns nothing
+    **/
+   void planOnEdge(AllocaInst* AI, BasicBlock* from, BasicBlock* to){
+      ScrubPlacement S;
+      if(!getStore0(AI, S)){
+	 return;
       }
-      else{
-	 if(I.getDebugLoc()){
-	    errs() << "adding STORE 0 (after)\t\t\t";
-	    I.getDebugLoc().print(errs());
-	    errs() << "\n";
+      const std::vector<unsigned> &edge = plan.getOnEdge(from, to);
+      S.site = onEdge;
+      S.from = from;
+      S.place = &*to->getFirstInsertionPt();
+      S.trigger = edge.empty() ? PlannedCode() : PlannedCode(nullptr, edge.front());//the first instruction of the new block
+      S.use = AI;
+      plan.add(S, true);
+   }
+
+   /**
+    * @function getFirstInsertionCode:
+    * @param BB, a block
+    * @returns the first instruction or STORE 0 of the plan a STORE 0 can be put before (after the phi nodes and the landing pad), the end if there is none
+    **/
+   PlannedCode getFirstInsertionCode(BasicBlock* BB){
+      for(PlannedCode C : plan.getCode(BB)){
+	 if(C.isScrub() || (!isa<PHINode>(C.instruction) && !C.instruction->isEHPad())){
+	    return C;
+	 }
+      }
+      return PlannedCode();
+   }
+
+   /**
+    * @function apply:
+    * adds the STORE 0 of the plan to the function, once all of them are decided:
+    * the critical edges which receive one are split, the dead ends are sent to their shared block and the returns are merged first.
+    * @param F, the current function
+    * @param loopData, the loops of F, kept up to date
+    * @param DT, the dominator tree of F, kept up to date
+    * @returns nothing
+    *
+    **/
+   void apply(Function& F, LoopInfo& loopData, DominatorTree& DT){
+      PhaseScope phase(timers, "apply", F);
+      std::map<std::pair<BasicBlock*, BasicBlock*>, Instruction*> edges;//the instruction ending the STORE 0 of each edge
+      bool coldExits = false;
+      bool returns = false;
+      for(unsigned i = 0; i < plan.size(); ++i){
+	 const ScrubPlacement &S = plan[i];
+	 std::pair<BasicBlock*, BasicBlock*> edge(S.from, S.site == onEdge ? S.place->getParent() : nullptr);
+	 if(!S.dropped && S.site == onEdge && !edges.count(edge)){//an edge whose STORE 0 were all hoisted is left as it is
+	    BasicBlock* split = splitEdge(edge.first, edge.second, loopData, DT);
+	    edges[edge] = split != nullptr ? split->getTerminator() : S.place;
+	 }
+	 coldExits |= !S.dropped && S.site == inDeadEnds;
+	 returns |= !S.dropped && S.site == beforeReturns;
+      }
+      BasicBlock* body = nullptr;
+      Instruction* coldEnd = coldExits ? add_cold_exits(F, body) : nullptr;
+      std::map<Instruction*, Instruction*> branches;//the returns replaced by a branch to the merged one
+      Instruction* returnEnd = nullptr;
+      if(returns){
+	 std::vector<std::pair<Instruction*, BasicBlock*>> returning;
+	 for(BasicBlock &BB : F){
+	    if(isa<ReturnInst>(BB.getTerminator())){
+	       returning.push_back(std::make_pair(BB.getTerminator(), &BB));
+	    }
+	 }
+	 unify_returns(F);
+	 returnEnd = F.back().getTerminator();
+	 for(auto RI : returning){
+	    if(RI.second->getTerminator() != RI.first){
+	       branches[RI.first] = RI.second->getTerminator();
+	    }
+	 }
+      }
+
+      std::vector<Instruction*> added(plan.size(), nullptr);
+      for(unsigned i = 0; i < plan.size(); ++i){
+	 const ScrubPlacement &S = plan[i];
+	 if(S.dropped || S.site == removedStore){
+	    continue;
+	 }
+	 if(S.site == programMemSet){
+	    addProgramScrub(S);
+	    continue;
+	 }
+	 Instruction* end = S.place;
+	 if(S.site == onEdge){
+	    end = edges[std::make_pair(S.from, S.place->getParent())];
+	 }
+	 else if(S.site == inDeadEnds){
+	    end = coldEnd;
+	 }
+	 else if(S.site == beforeReturns){
+	    end = returnEnd;
 	 }
+	 else if(branches.count(end)){
+	    end = branches[end];
+	 }
+	 else if(end == returnEnd){//the STORE 0 before the single return come before the ones of the returns
+	    for(unsigned index : plan.getBeforeReturns()){
+	       if(added[index] != nullptr){
+		  end = added[index];
+		  break;
+	       }
+	    }
+	 }
+	 Instruction* next = plan.getInsertionPoint(i, added, end);
+	 Instruction* trigger = getTrigger(S, added, next);
+	 if(S.type == nullptr && S.size > 0){
+	    added[i] = addRangeStore0(S, next, trigger);
+	 }
+	 else{
+	    added[i] = addStore0(S, next, trigger);
+	 }
+      }
+      if(coldExits && PaZOutlineCold && !PaZEstimate){//the estimation needs the STORE 0 in the function
+	 outline_cold(F, body);
+      }
+      for(unsigned i = 0; i < plan.size(); ++i){
+	 if(!plan[i].dropped && plan[i].site == removedStore){
+	    plan[i].place->eraseFromParent();
+	 }
+      }
+   }
+
+   /**
+    * @function getTrigger:
+    * @param S, a STORE 0 of the plan
+    * @param added, the STORE 0 already added
+    * @param next, the instruction it is added before
+    * @returns the instruction giving its debug location: its trigger, the one of a STORE 0 which was dropped
+    **/
+   Instruction* getTrigger(const ScrubPlacement& S, const std::vector<Instruction*>& added, Instruction* next){
+      PlannedCode trigger = S.trigger;
+      while(trigger.isScrub()){
+	 if(added[trigger.scrub] != nullptr){
+	    return added[trigger.scrub];
+	 }
+	 trigger = plan[trigger.scrub].trigger;
+      }
+      return trigger.isEnd() ? next : trigger.instruction;
+   }
+
+   /**
+    * @function addStore0
+    * adds a store 0 of a whole variable, before the instruction NextI.
+    * in debug mode, it tries to display where in the source code it decided to add this store 0 instruction.
+    * @param S, the STORE 0 planned
+    * @param NextI, the instruction before which we want to add a store 0 instruction
+    * @param trigger, the instruction giving its debug location
+    * @returns the store 0
+    *
+    **/
+   Instruction* addStore0(const ScrubPlacement& S, Instruction* NextI, Instruction* trigger){
+      AllocaInst* AI = cast<AllocaInst>(S.address);
+      IRBuilder<> Builder(NextI);
+      if(isDynamicArray(AI)){//a single memset of the whole array, its size is computed where it is set to 0
+	 const DataLayout &DL = AI->getModule()->getDataLayout();
+	 Type* sizeType = DL.getIntPtrType(AI->getType());
+	 Value* count = Builder.CreateZExtOrTrunc(AI->getArraySize(), sizeType);
+	 uint64_t elementSize = DL.getTypeAllocSize(AI->getAllocatedType());
+	 Value* size = count;
+	 if(elementSize != 1){
+	    size = Builder.CreateMul(count, ConstantInt::get(sizeType, elementSize), "paz.size");
+	 }
+#if LLVM_VERSION_MAJOR >= 10
+	 CallInst* memset = Builder.CreateMemSet(AI, Builder.getInt8(0), size, MaybeAlign(AI->getAlignment()), true);
+#else
+	 CallInst* memset = Builder.CreateMemSet(AI, Builder.getInt8(0), size, AI->getAlignment(), true);
+#endif
+	 tagScrub(memset, AI, "PutAtZero", trigger, S.reason);
+	 scrubs.push_back(memset);
+	 numSTORE0ADDED++;
+	 return memset;
+      }
+      StoreInst* Store0 = Builder.CreateStore(Constant::getNullValue(S.type), AI, true);//volatile=true in order to survive other passes
+      tagScrub(Store0, AI, "PutAtZero", trigger, S.reason);
+      scrubs.push_back(Store0);
+      if(S.use != nullptr && S.use->getDebugLoc() && !onCopy){//-debug-only=putatzero
+	 LLVM_DEBUG(dbgs() << "adding STORE 0 (after)\t\t\t"; S.use->getDebugLoc().print(dbgs()); dbgs() << "\n");
       }
       numSTORE0ADDED++;
+      return Store0;
+   }
+
+   /**
+    * @function report_estimates:
+    * displays the functions ranked by their estimated number of STORE 0 executed per call
+    **/
+   void report_estimates(){
+      std::sort(estimates.begin(), estimates.end(), [](const FunctionEstimate &a, const FunctionEstimate &b){
+	 return a.stores > b.stores;
+      });
+      errs() << "\033[0;36m======================================\033[0;0m\n";
+      errs() << "\033[0;36m=======   STORE 0 ESTIMATION   =======\033[0;0m\n";
+      errs() << "\033[0;36m======================================\033[0;0m\n";
+      errs() << "   stores/call     bytes/call   points   function\n";
+      for(const FunctionEstimate &estimation : estimates){
+	 errs() << format("%14.1f %14.1f %8u   ", estimation.stores, estimation.bytes, estimation.points) << estimation.name << "\n";
+      }
    }
 
    /**
@@ -754,12 +3510,70 @@ namespace {
     * @returns false because the code wasn't modified during its execution
     **/
    bool doFinalization(Module &M) override{
+      if(PaZEstimate){
+	 report_estimates();
+      }
+      if(!PaZPlanExport.empty() || PaZDryRun){
+	 export_plan();
+      }
+      timers.report();
+      if(!PaZQuiet){
+	 printStatistics();
+      }
+      return false;
+   }
+
+   /**
+    * @function printStatistics:
+    * displays the statistics of all the modules handled so far (the counters are shared by all the instances of the pass, and by the threads of paz-batch)
+    **/
+   static void printStatistics(){
       errs() << "\n(Information (if displayed) are in file:line:column mode)\n\n";
       errs() << "\033[0;36m======================================\033[0;0m\n";
       errs() << "\033[0;36m=======   TRACKER STATISTICS   =======\033[0;0m\n";
       errs() << "\033[0;36m======================================\033[0;0m\n";
       errs() << "\033[0;32m Added " << numSTORE0ADDED << " STORE 0 Instruction\033[0;0m\n";
-      return false;
+      errs() << "\033[0;31m Removed " << numSTORE0REMOVED << " duplicate STORE 0 Instruction\033[0;0m\n";
+      errs() << "\033[0;32m " << numCOLDEXITS << " unreachable/resume exits share their STORE 0\033[0;0m\n";
+      if(numSENSITIVEGLOBALS > 0){
+	 errs() << "\033[0;32m Moved " << numSENSITIVEGLOBALS << " global variables in the sensitive section\033[0;0m\n";
+      }
+      if(numCOROFRAMES > 0){
+	 errs() << "\033[0;32m Set " << numCOROFRAMES << " coroutine frames to 0 when destroyed\033[0;0m\n";
+      }
+      if(numLIFETIMEMOVED > 0){
+	 errs() << "\033[0;32m Moved " << numLIFETIMEMOVED << " STORE 0 between the lifetime markers of their variable\033[0;0m\n";
+      }
+      if(numEXITTIER > 0 || numBALANCEDTIER > 0){
+	 errs() << "\033[0;32m Tiers: " << numEXITTIER << " functions scrubbed at the exits, " << numBALANCEDTIER << " balanced, " << numLOOPHOISTED << " STORE 0 moved out of the loops\033[0;0m\n";
+      }
+      if(numSPLITEDGES > 0){
+	 errs() << "\033[0;32m Split " << numSPLITEDGES << " critical edges to put STORE 0 on them\033[0;0m\n";
+      }
+      if(numPROGRAMSCRUBS > 0){
+	 errs() << "\033[0;32m Kept " << numPROGRAMSCRUBS << " memset to 0 of the program instead of adding a STORE 0\033[0;0m\n";
+      }
+      if(PaZStackLeak){
+	 errs() << "\033[0;32m Stack high-water wipe: " << numSTACKENTRIES << " entry points, " << numSTACKTRACKED << " functions below them only tracked\033[0;0m\n";
+      }
+      if(numPLANNED > 0){
+	 errs() << "\033[0;32m " << numPLANNED << " functions placed from the imported plan, without the analysis\033[0;0m\n";
+      }
+      if(numQUARANTINED > 0){
+	 errs() << "\033[0;32m " << numQUARANTINED << " calls to free redirected to __paz_free\033[0;0m\n";
+      }
+      if(numSWITCHABLE > 0){
+	 errs() << "\033[0;32m " << numSWITCHABLE << " functions switch between their scrubbed and their plain version (__paz_scrub_enabled)\033[0;0m\n";
+      }
+      if(numOVERBUDGET > 0){
+	 errs() << "\033[0;31m " << numOVERBUDGET << " functions over the budget (-paz-budget, -paz-max-steps) set to 0 at the exits only\033[0;0m\n";
+      }
+      if(!PaZEstimate){
+	 errs() << "\033[0;32m Stack frames (estimated after StackColoring): " << numFRAMEBEFORE << " bytes without the STORE 0, " << numFRAMEAFTER << " bytes with them\033[0;0m\n";
+      }
+      if(PaZOptimized){
+	 errs() << "\033[0;32m Put back " << numDEMOTED << " sensitive values in memory\033[0;0m\n";
+      }
    }
 
 
@@ -767,5 +3581,36 @@ namespace {
 }
 
 char PutAtZero::ID = 0;
-int PutAtZero::numSTORE0ADDED = 0;
+ScrubStatistic<int> PutAtZero::numSTORE0ADDED(0);
+ScrubStatistic<int> PutAtZero::numSTORE0REMOVED(0);
+ScrubStatistic<int> PutAtZero::numDEMOTED(0);
+ScrubStatistic<int> PutAtZero::numCOLDEXITS(0);
+ScrubStatistic<int> PutAtZero::numSENSITIVEGLOBALS(0);
+ScrubStatistic<int> PutAtZero::numCOROFRAMES(0);
+ScrubStatistic<int> PutAtZero::numLIFETIMEMOVED(0);
+ScrubStatistic<int> PutAtZero::numEXITTIER(0);
+ScrubStatistic<int> PutAtZero::numBALANCEDTIER(0);
+ScrubStatistic<int> PutAtZero::numLOOPHOISTED(0);
+ScrubStatistic<int> PutAtZero::numSPLITEDGES(0);
+ScrubStatistic<int> PutAtZero::numPROGRAMSCRUBS(0);
+ScrubStatistic<int> PutAtZero::numOVERBUDGET(0);
+ScrubStatistic<int> PutAtZero::numSTACKENTRIES(0);
+ScrubStatistic<int> PutAtZero::numSTACKTRACKED(0);
+ScrubStatistic<int> PutAtZero::numSWITCHABLE(0);
+ScrubStatistic<int> PutAtZero::numPLANNED(0);
+ScrubStatistic<int> PutAtZero::numQUARANTINED(0);
+ScrubStatistic<uint64_t> PutAtZero::numFRAMEBEFORE(0);
+ScrubStatistic<uint64_t> PutAtZero::numFRAMEAFTER(0);
 static RegisterPass<PutAtZero> X("PaZ", "PutAtZero Pass");
+
+void printPutAtZeroStatistics(){
+   PutAtZero::printStatistics();
+}
+
+llvm::FunctionPass* createPutAtZeroPass(){
+   return new PutAtZero();
+}
+
+bool isPutAtZeroOptimized(){
+   return PaZOptimized;
+}
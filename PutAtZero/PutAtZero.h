@@ -15,5 +15,17 @@ typedef std::map<const llvm::BasicBlock* , std::vector<IsDead>> InstructionList;
 //each block has a set of variables with their respective status
 //this allows us to know in case of branches if the variable is dead on all the possible ways
 
+typedef std::vector<std::pair<uint64_t, uint64_t>> ByteRanges;
+//the bytes written in an array or a structure, each range goes from its first byte to the byte after its last one
+
+void printPutAtZeroStatistics();
+//the statistics of all the modules handled by the PutAtZero pass in this process (paz-batch)
+
+llvm::FunctionPass* createPutAtZeroPass();
+//a new PutAtZero pass, for the pipelines built outside of opt (link time and optimized pipelines of the plugin)
+
+bool isPutAtZeroOptimized();
+//true with -paz-optimized: the pass runs at the end of the optimized pipelines
+
 #endif
 
@@ -0,0 +1,37 @@
+/**
+ * Registration of PutAtZero in the pipelines of clang and of the linker, compiled in the plugin (LLVMPutAtZero.so) only:
+ * the tools which link the pass (paz-batch, PaZJIT) build their own pipelines and must not get it added to the ones of LLVM.
+ *	- link time: when the plugin is loaded in the linker (-Wl,-plugin-opt=-load=LLVMPutAtZero.so) the pass runs once on the merged module,
+ *	  after the cross module inlining, instead of once per translation unit (ThinLTO: in each backend)
+ *	- -paz-optimized: the pass is the last one of a regular optimized compilation
+ * @author INRIA Bordeaux STORM Project Team
+ **/
+
+#include "llvm/Config/llvm-config.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/Pass.h"
+#include "llvm/Transforms/IPO/PassManagerBuilder.h"
+#include <map>
+#include <vector>
+#include "PutAtZero.h"
+
+using namespace llvm;
+
+#if LLVM_VERSION_MAJOR >= 5//EP_FullLinkTimeOptimizationLast
+static void addPutAtZeroPass(const PassManagerBuilder &Builder, legacy::PassManagerBase &PM){
+   PM.add(createPutAtZeroPass());
+}
+
+static void addPutAtZeroThinLTOPass(const PassManagerBuilder &Builder, legacy::PassManagerBase &PM){
+   if(Builder.PerformThinLTO){//the ThinLTO backends (post link) only, not the compile step preparing the summaries
+      PM.add(createPutAtZeroPass());
+   }
+   else if(isPutAtZeroOptimized() && !Builder.PrepareForThinLTO && !Builder.PrepareForLTO){//last pass of a regular optimized compilation
+      PM.add(createPutAtZeroPass());
+   }
+}
+
+static RegisterStandardPasses PaZLTO(PassManagerBuilder::EP_FullLinkTimeOptimizationLast, addPutAtZeroPass);
+static RegisterStandardPasses PaZThinLTO(PassManagerBuilder::EP_OptimizerLast, addPutAtZeroThinLTOPass);
+#endif
@@ -0,0 +1,67 @@
+#ifndef RUNTIMESUPPORT_H
+#define RUNTIMESUPPORT_H
+
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DebugInfoMetadata.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/Instruction.h"
+#include "llvm/IR/Module.h"
+#include <map>
+#include <string>
+
+/**
+ * @function getRuntimeFunction:
+ * @returns the declaration of a function of ScrubRuntime, added to M if needed
+ **/
+inline llvm::Function* getRuntimeFunction(llvm::Module& M, llvm::StringRef name, llvm::FunctionType* FT){
+   llvm::Function* F = M.getFunction(name);
+   if(F == nullptr){
+      F = llvm::Function::Create(FT, llvm::GlobalValue::ExternalLinkage, name, &M);
+   }
+   return F;
+}
+
+/**
+ * @function getRuntimeString:
+ * @param strings the strings already added to M
+ * @returns a pointer to a constant string of M, shared by all the sites given to the runtime
+ **/
+inline llvm::Constant* getRuntimeString(llvm::Module& M, llvm::StringRef str, std::map<std::string, llvm::Constant*>& strings){
+   auto it = strings.find(str.str());
+   if(it != strings.end()){
+      return it->second;
+   }
+   llvm::Constant* init = llvm::ConstantDataArray::getString(M.getContext(), str);
+   llvm::GlobalVariable* GV = new llvm::GlobalVariable(M, init->getType(), true, llvm::GlobalValue::PrivateLinkage, init, ".str.paz");
+   GV->setUnnamedAddr(llvm::GlobalValue::UnnamedAddr::Global);
+   llvm::Constant* ptr = llvm::ConstantExpr::getBitCast(GV, llvm::Type::getInt8PtrTy(M.getContext()));
+   strings[str.str()] = ptr;
+   return ptr;
+}
+
+/**
+ * @function getSourceLocation:
+ * finds the location of I in the source code: its own DebugLoc, the one of the closest instruction before it, or the one of its function
+ * @returns nothing but file, line and column are set ("?", 0, 0 without debug information)
+ **/
+inline void getSourceLocation(llvm::Instruction* I, llvm::StringRef& file, unsigned& line, unsigned& column){
+   llvm::DebugLoc Loc = I->getDebugLoc();
+   for(llvm::Instruction* prev = I->getPrevNode(); !Loc && prev != nullptr; prev = prev->getPrevNode()){
+      Loc = prev->getDebugLoc();
+   }
+   file = "?";
+   line = 0;
+   column = 0;
+   if(Loc){
+      file = Loc->getFilename();
+      line = Loc.getLine();
+      column = Loc.getCol();
+   }
+   else if(llvm::DISubprogram* SP = I->getFunction()->getSubprogram()){
+      file = SP->getFilename();
+      line = SP->getLine();
+   }
+}
+
+#endif
@@ -0,0 +1,111 @@
+/**
+ * Instrumentation of the -paz-count mode: counts how many times each STORE 0 is executed.
+ * The module gets a descriptor of its STORE 0 (struct paz_sites of ScrubRuntime/PaZRuntime.h) registered by a constructor,
+ * and every instrumented function asks the runtime for the counters of its thread once, at its entry.
+ * @author INRIA Bordeaux STORM Project Team
+ **/
+
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/Transforms/Utils/ModuleUtils.h"
+#include "RuntimeSupport.h"
+#include "ScrubCounters.h"
+
+using namespace llvm;
+
+/**
+ * @function initialize:
+ * adds the descriptor of the module, left empty until finalize once every function is instrumented
+ * @param M the current module
+ **/
+void ScrubCounters::initialize(Module& M){
+   LLVMContext &Ctx = M.getContext();
+   Type* i8ptr = Type::getInt8PtrTy(Ctx);
+   Type* i32 = Type::getInt32Ty(Ctx);
+   sites.clear();
+   strings.clear();
+   siteType = StructType::create(Ctx, {i8ptr, i8ptr, i32, i32}, "struct.paz_site");
+   StructType* sitesType = StructType::create(Ctx, {i8ptr, siteType->getPointerTo(), i32, i8ptr}, "struct.paz_sites");
+   descriptor = new GlobalVariable(M, sitesType, false, GlobalValue::InternalLinkage, Constant::getNullValue(sitesType), "paz.sites");
+   threadCounters = getRuntimeFunction(M, "__paz_thread_counters",
+	 FunctionType::get(Type::getInt64PtrTy(Ctx), {sitesType->getPointerTo()}, false));
+}
+
+/**
+ * @function instrument:
+ * adds the increment of a counter before each STORE 0
+ * @param F the function just handled by the pass
+ * @param scrubs the STORE 0 added to F (or to the cold function outlined from F)
+ **/
+void ScrubCounters::instrument(Function& F, const std::vector<Instruction*>& scrubs){
+   std::map<Function*, Value*> counters;
+   Type* i64 = Type::getInt64Ty(F.getContext());
+   for(Instruction* I : scrubs){
+      Value* base = getCounters(I->getFunction(), counters);
+      Value* index = ConstantInt::get(i64, sites.size());
+      sites.push_back(getSite(I));
+      Instruction* counter = GetElementPtrInst::CreateInBounds(i64, base, {index}, "paz.counter", I);
+      IRBuilder<> Builder(I);
+      Value* count = Builder.CreateLoad(i64, counter, "paz.count");
+      Builder.CreateStore(Builder.CreateAdd(count, ConstantInt::get(i64, 1)), counter);
+   }
+}
+
+/**
+ * @function getCounters:
+ * @param F a function
+ * @param counters the counters already asked in each function
+ * @returns the counters of the current thread, asked to the runtime at the entry of F the first time
+ **/
+Value* ScrubCounters::getCounters(Function* F, std::map<Function*, Value*>& counters){
+   auto it = counters.find(F);
+   if(it != counters.end()){
+      return it->second;
+   }
+   IRBuilder<> Builder(&*F->getEntryBlock().getFirstInsertionPt());
+   Value* base = Builder.CreateCall(threadCounters, {descriptor}, "paz.counters");
+   counters[F] = base;
+   return base;
+}
+
+/**
+ * @function getSite:
+ * @param I a STORE 0
+ * @returns the location of I in the source code
+ **/
+Constant* ScrubCounters::getSite(Instruction* I){
+   Module &M = *I->getModule();
+   Type* i32 = Type::getInt32Ty(M.getContext());
+   StringRef file;
+   unsigned line;
+   unsigned column;
+   getSourceLocation(I, file, line, column);
+   //an outlined cold function is named after the function it comes from
+   return ConstantStruct::get(siteType, {getRuntimeString(M, file, strings), getRuntimeString(M, I->getFunction()->getName(), strings),
+	 ConstantInt::get(i32, line), ConstantInt::get(i32, column)});
+}
+
+/**
+ * @function finalize:
+ * fills the descriptor with the locations of all the STORE 0 and adds the constructor registering it
+ * @param M the current module
+ **/
+void ScrubCounters::finalize(Module& M){
+   LLVMContext &Ctx = M.getContext();
+   ArrayType* arrayType = ArrayType::get(siteType, sites.size());
+   GlobalVariable* array = new GlobalVariable(M, arrayType, true, GlobalValue::InternalLinkage,
+	 ConstantArray::get(arrayType, sites), "paz.sites.locations");
+   StructType* sitesType = cast<StructType>(descriptor->getValueType());
+   descriptor->setInitializer(ConstantStruct::get(sitesType, {getRuntimeString(M, M.getModuleIdentifier(), strings),
+	 ConstantExpr::getBitCast(array, siteType->getPointerTo()),
+	 ConstantInt::get(Type::getInt32Ty(Ctx), sites.size()),
+	 Constant::getNullValue(Type::getInt8PtrTy(Ctx))}));
+
+   Function* registerSites = getRuntimeFunction(M, "__paz_register_sites",
+	 FunctionType::get(Type::getVoidTy(Ctx), {descriptor->getType()}, false));
+   Function* ctor = Function::Create(FunctionType::get(Type::getVoidTy(Ctx), false), GlobalValue::InternalLinkage, "paz.register", &M);
+   IRBuilder<> Builder(BasicBlock::Create(Ctx, "entry", ctor));
+   Builder.CreateCall(registerSites, {descriptor});
+   Builder.CreateRetVoid();
+   appendToGlobalCtors(M, ctor, 0);
+}
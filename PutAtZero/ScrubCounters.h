@@ -0,0 +1,28 @@
+#ifndef SCRUBCOUNTERS_H
+#define SCRUBCOUNTERS_H
+
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Instructions.h"
+#include <map>
+#include <vector>
+
+//-paz-count: each STORE 0 added by the pass also increments its own counter
+//the counters are allocated per thread by the runtime (ScrubRuntime/PaZRuntime.c) which writes them at exit
+class ScrubCounters{
+ public:
+   void initialize(llvm::Module& M);
+   void instrument(llvm::Function& F, const std::vector<llvm::Instruction*>& scrubs);
+   void finalize(llvm::Module& M);
+
+ private:
+   llvm::GlobalVariable* descriptor;//struct paz_sites of the module
+   llvm::StructType* siteType;//struct paz_site
+   llvm::Function* threadCounters;//__paz_thread_counters
+   std::vector<llvm::Constant*> sites;
+   std::map<std::string, llvm::Constant*> strings;//file and function names
+
+   llvm::Value* getCounters(llvm::Function* F, std::map<llvm::Function*, llvm::Value*>& counters);
+   llvm::Constant* getSite(llvm::Instruction* I);
+};
+
+#endif
@@ -0,0 +1,239 @@
+/**
+ * Instrumentation of the -paz-verify mode: checks at runtime that no dead value survives the STORE 0 placement.
+ * The shadow of a variable is updated after each write (live) and each STORE 0 (scrubbed) by a small memset;
+ * before each exit (return, resume, call ending with unreachable) the runtime reports the bytes still live and not 0.
+ * @author INRIA Bordeaux STORM Project Team
+ **/
+
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/Config/llvm-config.h"
+#include <algorithm>
+#include "RuntimeSupport.h"
+#include "ScrubVerifier.h"
+
+using namespace llvm;
+
+/**
+ * @function initialize:
+ * declares the site type and the check of the runtime in M
+ * @param M the current module
+ **/
+void ScrubVerifier::initialize(Module& M){
+   LLVMContext &Ctx = M.getContext();
+   Type* i8ptr = Type::getInt8PtrTy(Ctx);
+   Type* i32 = Type::getInt32Ty(Ctx);
+   strings.clear();
+   siteType = StructType::create(Ctx, {i8ptr, i8ptr, i8ptr, i32, i32}, "struct.paz_verify_site");
+   verifySlot = getRuntimeFunction(M, "__paz_verify_slot",
+	 FunctionType::get(Type::getVoidTy(Ctx), {siteType->getPointerTo(), i8ptr, i8ptr, Type::getInt64Ty(Ctx)}, false));
+}
+
+/**
+ * @function instrument:
+ * adds the shadows of the variables, their updates and the checks at the exits
+ * @param F the function just handled by the pass
+ * @param slots the variables to check (the ones with a size known at compile time)
+ * @param scrubs the STORE 0 added to F
+ **/
+void ScrubVerifier::instrument(Function& F, const std::vector<AllocaInst*>& slots, const std::vector<Instruction*>& scrubs){
+   shadows.clear();
+   std::vector<Instruction*> code;//the instructions of the function, without the ones added here
+   std::vector<Instruction*> exits;
+   for(BasicBlock &BB : F){
+      for(Instruction &I : BB){
+	 code.push_back(&I);
+      }
+      Instruction* T = BB.getTerminator();
+      if(isa<ReturnInst>(T) || isa<ResumeInst>(T)){
+	 exits.push_back(T);
+      }
+      else if(isa<UnreachableInst>(T)){//the frame is left by the call before (abort, exit, __cxa_throw...)
+	 CallInst* CI = dyn_cast_or_null<CallInst>(T->getPrevNode());
+	 exits.push_back(CI != nullptr && CI->doesNotReturn() ? CI : T);
+      }
+   }
+   IRBuilder<> Builder(&*F.getEntryBlock().getFirstInsertionPt());
+   for(AllocaInst* AI : slots){
+      AllocaInst* shadow = Builder.CreateAlloca(ArrayType::get(Builder.getInt8Ty(), getSize(AI)), nullptr, AI->getName() + ".paz.shadow");
+      shadows[AI] = shadow;
+   }
+   for(AllocaInst* AI : slots){
+#if LLVM_VERSION_MAJOR >= 10
+      Builder.CreateMemSet(shadows[AI], Builder.getInt8(shadowUnknown), getSize(AI), MaybeAlign(1));
+#else
+      Builder.CreateMemSet(shadows[AI], Builder.getInt8(shadowUnknown), getSize(AI), 1);
+#endif
+   }
+   for(Instruction* I : code){
+      markWrites(I, scrubs);
+      markEscapes(I);
+   }
+   for(Instruction* exit : exits){
+      for(AllocaInst* AI : slots){
+	 check(AI, exit);
+      }
+   }
+}
+
+/**
+ * @function getSlot:
+ * @param pointer an address
+ * @param length the number of bytes accessed from pointer, 0 if unknown
+ * @param begin, end set to the bytes accessed in the variable (the whole variable when the offset or the length is not constant)
+ * @returns the checked variable pointer points in, nullptr if there is none
+ **/
+AllocaInst* ScrubVerifier::getSlot(Value* pointer, uint64_t length, uint64_t& begin, uint64_t& end){
+   AllocaInst* AI = dyn_cast<AllocaInst>(pointer->stripInBoundsOffsets());
+   if(AI == nullptr || shadows.count(AI) == 0){
+      return nullptr;
+   }
+   const DataLayout &DL = AI->getModule()->getDataLayout();
+   APInt offset(DL.getPointerSizeInBits(AI->getType()->getPointerAddressSpace()), 0);
+   uint64_t size = getSize(AI);
+   begin = 0;
+   end = size;
+   if(length != 0 && pointer->stripAndAccumulateInBoundsConstantOffsets(DL, offset) == AI && !offset.isNegative() && offset.getZExtValue() < size){
+      begin = offset.getZExtValue();
+      end = std::min(size, begin + length);
+   }
+   return AI;
+}
+
+/**
+ * @function markWrites:
+ * marks the bytes written by I as live, or as scrubbed if I is a STORE 0 of the pass
+ * @param I an instruction of the function
+ * @param scrubs the STORE 0 added to the function
+ **/
+void ScrubVerifier::markWrites(Instruction* I, const std::vector<Instruction*>& scrubs){
+   Value* pointer = nullptr;
+   uint64_t length = 0;//0: up to the end of the variable
+   const DataLayout &DL = I->getModule()->getDataLayout();
+   if(StoreInst* SI = dyn_cast<StoreInst>(I)){
+      pointer = SI->getPointerOperand();
+      length = DL.getTypeStoreSize(SI->getValueOperand()->getType());
+   }
+   else if(MemIntrinsic* MI = dyn_cast<MemIntrinsic>(I)){
+      pointer = MI->getDest();
+      if(ConstantInt* C = dyn_cast<ConstantInt>(MI->getLength())){
+	 length = C->getZExtValue();
+      }
+   }
+   uint64_t begin;
+   uint64_t end;
+   AllocaInst* AI = pointer != nullptr ? getSlot(pointer, length, begin, end) : nullptr;
+   if(AI == nullptr){
+      return;
+   }
+   bool scrub = std::find(scrubs.begin(), scrubs.end(), I) != scrubs.end();
+   mark(AI, begin, end, scrub ? shadowScrubbed : shadowLive, I->getNextNode());
+}
+
+/**
+ * @function markEscapes:
+ * a variable whose address is given to a call or stored in memory can be written anywhere afterwards:
+ * the whole variable is marked as live after the call or the store
+ * @param I an instruction of the function
+ **/
+void ScrubVerifier::markEscapes(Instruction* I){
+   std::vector<Value*> addresses;
+   Instruction* after = I->getNextNode();
+   if(StoreInst* SI = dyn_cast<StoreInst>(I)){
+      addresses.push_back(SI->getValueOperand());
+   }
+   else if(isa<CallInst>(I) || isa<InvokeInst>(I)){
+      if(isa<IntrinsicInst>(I)){//memset/memcpy are writes, dbg and lifetime markers do nothing
+	 return;
+      }
+      for(Use &U : I->operands()){
+	 addresses.push_back(U.get());
+      }
+      if(InvokeInst* II = dyn_cast<InvokeInst>(I)){
+	 after = &*II->getNormalDest()->getFirstInsertionPt();
+      }
+   }
+   for(Value* V : addresses){
+      if(!V->getType()->isPointerTy()){
+	 continue;
+      }
+      uint64_t begin;
+      uint64_t end;
+      if(AllocaInst* AI = getSlot(V, 0, begin, end)){
+	 mark(AI, 0, getSize(AI), shadowLive, after);
+      }
+   }
+}
+
+/**
+ * @function mark:
+ * sets the shadow of some bytes of a variable
+ * @param AI the variable
+ * @param begin, end the bytes
+ * @param state their new state
+ * @param place the instruction before which the shadow is set
+ **/
+void ScrubVerifier::mark(AllocaInst* AI, uint64_t begin, uint64_t end, ShadowState state, Instruction* place){
+   if(place == nullptr || begin >= end){
+      return;
+   }
+   if(isa<PHINode>(place) || place->isEHPad()){
+      place = &*place->getParent()->getFirstInsertionPt();
+   }
+   IRBuilder<> Builder(place);
+   Value* shadow = GetElementPtrInst::CreateInBounds(shadows[AI]->getAllocatedType(), shadows[AI],
+	 {Builder.getInt64(0), Builder.getInt64(begin)}, "paz.shadow.bytes", place);
+#if LLVM_VERSION_MAJOR >= 10
+   Builder.CreateMemSet(shadow, Builder.getInt8(state), end - begin, MaybeAlign(1));
+#else
+   Builder.CreateMemSet(shadow, Builder.getInt8(state), end - begin, 1);
+#endif
+}
+
+/**
+ * @function check:
+ * adds the call to the runtime checking AI before an exit
+ * @param AI the variable
+ * @param exit the instruction leaving the function
+ **/
+void ScrubVerifier::check(AllocaInst* AI, Instruction* exit){
+   Module &M = *AI->getModule();
+   LLVMContext &Ctx = M.getContext();
+   StringRef file;
+   unsigned line;
+   unsigned column;
+   getSourceLocation(exit, file, line, column);
+   Constant* init = ConstantStruct::get(siteType, {getRuntimeString(M, exit->getFunction()->getName(), strings),
+	 getRuntimeString(M, getVariableName(AI), strings), getRuntimeString(M, file, strings),
+	 ConstantInt::get(Type::getInt32Ty(Ctx), line), ConstantInt::get(Type::getInt32Ty(Ctx), 0)});
+   GlobalVariable* site = new GlobalVariable(M, siteType, false, GlobalValue::PrivateLinkage, init, "paz.verify.site");
+   IRBuilder<> Builder(exit);
+   Builder.CreateCall(verifySlot, {site, Builder.CreateBitCast(AI, Builder.getInt8PtrTy()),
+	 Builder.CreateBitCast(shadows[AI], Builder.getInt8PtrTy()), Builder.getInt64(getSize(AI))});
+}
+
+/**
+ * @function getVariableName:
+ * @returns the name of the variable in the source code (llvm.dbg.declare), or the name of the alloca
+ **/
+StringRef ScrubVerifier::getVariableName(AllocaInst* AI){
+   for(BasicBlock &BB : *AI->getFunction()){
+      for(Instruction &I : BB){
+	 DbgDeclareInst* DDI = dyn_cast<DbgDeclareInst>(&I);
+	 if(DDI != nullptr && DDI->getAddress() == AI){
+	    return DDI->getVariable()->getName();
+	 }
+      }
+   }
+   return AI->hasName() ? AI->getName() : "?";
+}
+
+/**
+ * @function getSize:
+ * @returns the number of bytes of a variable
+ **/
+uint64_t ScrubVerifier::getSize(AllocaInst* AI){
+   const DataLayout &DL = AI->getModule()->getDataLayout();
+   return DL.getTypeAllocSize(AI->getAllocatedType());
+}
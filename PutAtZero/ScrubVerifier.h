@@ -0,0 +1,36 @@
+#ifndef SCRUBVERIFIER_H
+#define SCRUBVERIFIER_H
+
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Instructions.h"
+#include <map>
+#include <vector>
+
+//-paz-verify: each byte of a variable has a shadow byte in the frame, with the same values as enum paz_shadow_state (ScrubRuntime/PaZRuntime.h)
+//unknown  -> not written by the function (garbage of an older frame)
+//live     -> written since the last STORE 0, it is dead-unscrubbed when the function exits
+//scrubbed -> set to 0 by a STORE 0
+enum ShadowState{shadowUnknown = 0, shadowLive = 1, shadowScrubbed = 2};
+
+//the runtime checks the variables at each exit and reports the live bytes which are not 0
+class ScrubVerifier{
+ public:
+   void initialize(llvm::Module& M);
+   void instrument(llvm::Function& F, const std::vector<llvm::AllocaInst*>& slots, const std::vector<llvm::Instruction*>& scrubs);
+
+ private:
+   llvm::StructType* siteType;//struct paz_verify_site
+   llvm::Function* verifySlot;//__paz_verify_slot
+   std::map<llvm::AllocaInst*, llvm::AllocaInst*> shadows;//the shadow of each variable of the current function
+   std::map<std::string, llvm::Constant*> strings;//file, function and variable names
+
+   llvm::AllocaInst* getSlot(llvm::Value* pointer, uint64_t length, uint64_t& begin, uint64_t& end);
+   void mark(llvm::AllocaInst* AI, uint64_t begin, uint64_t end, ShadowState state, llvm::Instruction* place);
+   void markWrites(llvm::Instruction* I, const std::vector<llvm::Instruction*>& scrubs);
+   void markEscapes(llvm::Instruction* I);
+   void check(llvm::AllocaInst* AI, llvm::Instruction* exit);
+   llvm::StringRef getVariableName(llvm::AllocaInst* AI);
+   uint64_t getSize(llvm::AllocaInst* AI);
+};
+
+#endif
@@ -0,0 +1,131 @@
+/**
+ * Sensitive global variables: instead of a STORE 0 after each of their uses, in each module,
+ * they all share one section which the runtime sets to 0 with a single memset.
+ * @author INRIA Bordeaux STORM Project Team
+ **/
+
+#include "llvm/ADT/Triple.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/ModuleUtils.h"
+#include <set>
+#include "RuntimeSupport.h"
+#include "SensitiveGlobals.h"
+
+using namespace llvm;
+
+static const char* SensitiveSection = "paz_sensitive";//a C identifier: the linker defines __start_paz_sensitive and __stop_paz_sensitive
+
+/**
+ * @function getGlobalAnnotations:
+ * @param M the current module
+ * @returns the values annotated with __attribute__((annotate(...))) and their annotation (llvm.global.annotations)
+ **/
+std::vector<std::pair<GlobalValue*, std::string>> getGlobalAnnotations(Module& M){
+   std::vector<std::pair<GlobalValue*, std::string>> annotations;
+   GlobalVariable* table = M.getNamedGlobal("llvm.global.annotations");
+   if(table == nullptr || !table->hasInitializer()){
+      return annotations;
+   }
+   ConstantArray* array = dyn_cast<ConstantArray>(table->getInitializer());
+   if(array == nullptr){
+      return annotations;
+   }
+   for(Use &U : array->operands()){//{annotated value, annotation, file, line...}
+      ConstantStruct* entry = dyn_cast<ConstantStruct>(U.get());
+      if(entry == nullptr || entry->getNumOperands() < 2){
+	 continue;
+      }
+      GlobalValue* GV = dyn_cast<GlobalValue>(entry->getOperand(0)->stripPointerCasts());
+      GlobalVariable* text = dyn_cast<GlobalVariable>(entry->getOperand(1)->stripPointerCasts());
+      if(GV == nullptr || text == nullptr || !text->hasInitializer()){
+	 continue;
+      }
+      ConstantDataArray* annotation = dyn_cast<ConstantDataArray>(text->getInitializer());
+      if(annotation != nullptr && annotation->isCString()){
+	 annotations.push_back(std::make_pair(GV, annotation->getAsCString().str()));
+      }
+   }
+   return annotations;
+}
+
+/**
+ * @function getAnnotatedGlobals:
+ * @param M the current module
+ * @returns the global variables with the annotation paz_sensitive
+ **/
+static std::set<GlobalVariable*> getAnnotatedGlobals(Module& M){
+   std::set<GlobalVariable*> annotated;
+   for(auto &annotation : getGlobalAnnotations(M)){
+      GlobalVariable* GV = dyn_cast<GlobalVariable>(annotation.first);
+      if(GV != nullptr && annotation.second == SensitiveSection){
+	 annotated.insert(GV);
+      }
+   }
+   return annotated;
+}
+
+/**
+ * @function addWipeAtExit:
+ * adds the destructor calling __paz_wipe_sensitive_globals.
+ * It is in a comdat and its llvm.global_dtors entry is associated to it: the linker keeps a single one for the whole program.
+ * @param M the current module
+ **/
+static void addWipeAtExit(Module& M){
+   if(M.getFunction("__paz_wipe_at_exit") != nullptr){
+      return;
+   }
+   LLVMContext &Ctx = M.getContext();
+   FunctionType* FT = FunctionType::get(Type::getVoidTy(Ctx), false);
+   Function* wipe = getRuntimeFunction(M, "__paz_wipe_sensitive_globals", FT);
+   Function* dtor = Function::Create(FT, GlobalValue::LinkOnceODRLinkage, "__paz_wipe_at_exit", &M);
+   dtor->setVisibility(GlobalValue::HiddenVisibility);
+   dtor->setComdat(M.getOrInsertComdat(dtor->getName()));
+   IRBuilder<> Builder(BasicBlock::Create(Ctx, "entry", dtor));
+   Builder.CreateCall(wipe, {});
+   Builder.CreateRetVoid();
+   appendToGlobalDtors(M, dtor, 0, dtor);//priority 0: after the other destructors
+}
+
+/**
+ * @function moveSensitiveGlobals:
+ * puts the sensitive global variables defined in the module in the section paz_sensitive
+ * @param M the current module
+ * @param names the names given with -paz-sensitive
+ * @returns the number of global variables moved
+ **/
+unsigned moveSensitiveGlobals(Module& M, const std::vector<std::string>& names){
+   std::set<GlobalVariable*> selected = getAnnotatedGlobals(M);
+   for(const std::string &name : names){
+      if(GlobalVariable* GV = M.getNamedGlobal(name)){
+	 selected.insert(GV);
+      }
+   }
+   if(selected.empty()){
+      return 0;
+   }
+   if(!Triple(M.getTargetTriple()).isOSBinFormatELF()){
+      errs() << "the sensitive global variables need an ELF target, they are left in place\n";
+      return 0;
+   }
+   unsigned moved = 0;
+   for(GlobalVariable* GV : selected){
+      if(GV->isDeclaration()){//moved by the module defining it
+	 continue;
+      }
+      if(GV->isConstant() || GV->isThreadLocal() || GV->hasComdat()){//read only, one copy per thread, or merged by the linker
+	 errs() << "can't put " << GV->getName() << " in the sensitive section\n";
+	 continue;
+      }
+      if(GV->hasCommonLinkage()){//a common symbol has no section: defined here as with -fno-common
+	 GV->setLinkage(GlobalValue::ExternalLinkage);
+      }
+      GV->setSection(SensitiveSection);
+      moved++;
+   }
+   if(moved > 0){
+      addWipeAtExit(M);
+   }
+   return moved;
+}
@@ -0,0 +1,17 @@
+#ifndef SENSITIVEGLOBALS_H
+#define SENSITIVEGLOBALS_H
+
+#include "llvm/IR/Module.h"
+#include <string>
+#include <utility>
+#include <vector>
+
+//the global variables annotated with __attribute__((annotate("paz_sensitive"))) or named with -paz-sensitive
+//are gathered in the section paz_sensitive, set to 0 at once by ScrubRuntime when the program ends
+//or when it calls __paz_wipe_sensitive_globals()
+unsigned moveSensitiveGlobals(llvm::Module& M, const std::vector<std::string>& names);
+
+//the values annotated with __attribute__((annotate("..."))) in the module, with their annotation
+std::vector<std::pair<llvm::GlobalValue*, std::string>> getGlobalAnnotations(llvm::Module& M);
+
+#endif
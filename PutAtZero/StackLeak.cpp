@@ -0,0 +1,222 @@
+/**
+ * Instrumentation of the -paz-stackleak mode, after the STACKLEAK plugin of the Linux kernel:
+ * the deep call chains under an API boundary (decrypt()...) do not set their frames to 0 one by one.
+ * Each function below an entry point only lowers the high-water mark of its thread to its own stack pointer (a load, a select, a store),
+ * and the entry point wipes the whole range between the lowest address reached and its own frame before it returns.
+ * The spills and the temporaries of the callees, which no STORE 0 reaches, are wiped too.
+ * The wipe is a loop of volatile stores inlined in the entry point: a call (memset, the runtime) would have its own frame inside the range.
+ * @author INRIA Bordeaux STORM Project Team
+ **/
+
+#include "llvm/Analysis/CallGraph.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Intrinsics.h"
+#include "llvm/Config/llvm-config.h"
+#include <algorithm>
+#include "RuntimeSupport.h"
+#include "ScrubMetadata.h"
+#include "SensitiveGlobals.h"
+#include "StackLeak.h"
+
+using namespace llvm;
+
+/**
+ * @function initialize:
+ * finds the entry points and the functions below them, and declares the high-water mark and the functions of the runtime in M (unless there is no entry point)
+ * @param M the current module
+ * @param names the entry points given with -paz-entry
+ * @param slack the bytes also wiped below the lowest address recorded: the frames of the uninstrumented functions (libc...) called by the deepest one
+ **/
+void StackLeak::initialize(Module& M, const std::vector<std::string>& names, uint64_t slack){
+   LLVMContext &Ctx = M.getContext();
+   Type* i8ptr = Type::getInt8PtrTy(Ctx);
+   Type* intptr = M.getDataLayout().getIntPtrType(Ctx);
+   this->slack = slack;
+   entries.clear();
+   for(Function &F : M){
+      if(F.hasFnAttribute("paz-entry") || std::find(names.begin(), names.end(), F.getName().str()) != names.end()){
+	 entries.insert(&F);
+      }
+   }
+   for(auto &annotation : getGlobalAnnotations(M)){
+      if(isa<Function>(annotation.first) && annotation.second == "paz_entry"){
+	 entries.insert(cast<Function>(annotation.first));
+      }
+   }
+   below.clear();
+   if(entries.empty()){//nothing is wiped, nothing is declared
+      return;
+   }
+   findBelow(M);
+   lowest = M.getNamedGlobal("__paz_stack_lowest");
+   if(lowest == nullptr){
+      lowest = new GlobalVariable(M, intptr, false, GlobalValue::ExternalLinkage, nullptr, "__paz_stack_lowest", nullptr, GlobalValue::GeneralDynamicTLSModel);
+   }
+   enter = getRuntimeFunction(M, "__paz_stack_enter", FunctionType::get(intptr, {i8ptr}, false));
+#if LLVM_VERSION_MAJOR >= 18
+   stackSave = Intrinsic::getDeclaration(&M, Intrinsic::stacksave, {i8ptr});
+#else
+   stackSave = Intrinsic::getDeclaration(&M, Intrinsic::stacksave);
+#endif
+}
+
+/**
+ * @function findBelow:
+ * finds the functions only called below the entry points: reachable from them in the call graph, and with no direct call from a function which is not.
+ * Only the internal functions whose address is never taken can be below: the others may be called from another module or through a pointer,
+ * and keep their own STORE 0.
+ * @param M the current module
+ **/
+void StackLeak::findBelow(Module& M){
+   for(Function &F : M){
+      if(F.isMaterializable()){//paz-batch -lazy: the calls of the functions not read yet are unknown, every function keeps its STORE 0
+	 errs() << "\033[0;31m-paz-stackleak: " << M.getModuleIdentifier() << " is read lazily, the functions below the entry points set their frame to 0\033[0;0m\n";
+	 return;
+      }
+   }
+   CallGraph CG(M);
+   std::vector<CallGraphNode*> work;
+   for(const Function* F : entries){
+      work.push_back(CG[F]);
+   }
+   while(!work.empty()){
+      CallGraphNode* node = work.back();
+      work.pop_back();
+      for(auto &call : *node){
+	 Function* callee = call.second->getFunction();
+	 if(callee != nullptr && !callee->isDeclaration() && callee->hasLocalLinkage() && !callee->hasAddressTaken() && !entries.count(callee) && below.insert(callee).second){
+	    work.push_back(call.second);
+	 }
+      }
+   }
+   bool changed = true;
+   while(changed){//a function called from above the entry points would leave its frame on the stack: it keeps its STORE 0, and so do its callees
+      changed = false;
+      for(Function &F : M){
+	 if(F.isDeclaration() || entries.count(&F) || below.count(&F)){
+	    continue;
+	 }
+	 for(auto &call : *CG[&F]){
+	    Function* callee = call.second->getFunction();
+	    if(callee != nullptr && below.erase(callee)){
+	       changed = true;
+	    }
+	 }
+      }
+   }
+}
+
+/**
+ * @function isEntry:
+ * @returns true if F is an entry point: its stack range is wiped when it returns
+ **/
+bool StackLeak::isEntry(Function& F) const{
+   return entries.count(&F) != 0;
+}
+
+/**
+ * @function isTracked:
+ * @returns true if F only runs below the entry points: it lowers the high-water mark instead of setting its frame to 0
+ **/
+bool StackLeak::isTracked(Function& F) const{
+   return below.count(&F) != 0;
+}
+
+/**
+ * @function getNumEntries:
+ * @returns the number of entry points of the module
+ **/
+unsigned StackLeak::getNumEntries() const{
+   return entries.size();
+}
+
+/**
+ * @function getStackPointer:
+ * reads the stack pointer once the frame of F is allocated (after the static allocas)
+ * @param F a function
+ * @returns the llvm.stacksave call
+ **/
+Instruction* StackLeak::getStackPointer(Function& F){
+   BasicBlock::iterator it = F.getEntryBlock().begin();
+   while(isa<AllocaInst>(&*it)){
+      ++it;
+   }
+   return CallInst::Create(stackSave, "paz.sp", &*it);
+}
+
+/**
+ * @function instrumentEntry:
+ * records the stack pointer at the entry of F and wipes the stack used below it before its returns and resumes
+ * (an exception going through F without a landing pad skips the wipe)
+ * @param F an entry point, already handled by the pass: its own frame keeps its STORE 0
+ **/
+void StackLeak::instrumentEntry(Function& F){
+   Instruction* top = getStackPointer(F);
+   IRBuilder<> Builder(top->getNextNode());
+   Value* saved = Builder.CreateCall(enter, {top}, "paz.saved");
+   Value* topAddress = Builder.CreatePtrToInt(top, lowest->getValueType());
+   std::vector<Instruction*> exits;
+   for(BasicBlock &BB : F){
+      Instruction* T = BB.getTerminator();
+      if(!isa<ReturnInst>(T) && !isa<ResumeInst>(T)){
+	 continue;
+      }
+      CallInst* CI = dyn_cast_or_null<CallInst>(T->getPrevNode());
+      exits.push_back(CI != nullptr && CI->isMustTailCall() ? CI : T);//nothing can be put between a musttail call and its return
+   }
+   for(Instruction* exit : exits){
+      wipe(exit, saved, topAddress);
+   }
+}
+
+/**
+ * @function wipe:
+ * sets the words from the lowest address recorded (minus the slack) up to top to 0, then gives the high-water mark back to the entry point running above F
+ * (everything below F is clean: its own stack pointer)
+ * @param exit the instruction the wipe is put before
+ * @param saved the high-water mark returned by __paz_stack_enter
+ * @param top the stack pointer of the entry point
+ **/
+void StackLeak::wipe(Instruction* exit, Value* saved, Value* top){
+   Type* intptr = lowest->getValueType();
+   uint64_t word = intptr->getPrimitiveSizeInBits() / 8;
+   BasicBlock* before = exit->getParent();
+   BasicBlock* after = before->splitBasicBlock(exit, "paz.wiped");
+   BasicBlock* loop = BasicBlock::Create(before->getContext(), "paz.wipe", before->getParent(), after);
+   before->getTerminator()->eraseFromParent();
+
+   IRBuilder<> Builder(before);
+   Value* mark = Builder.CreateLoad(lowest->getValueType(), lowest, "paz.lowest");
+   Value* deep = Builder.CreateICmpUGT(mark, ConstantInt::get(intptr, slack));
+   Value* begin = Builder.CreateAnd(Builder.CreateSub(mark, ConstantInt::get(intptr, slack)), ConstantInt::get(intptr, ~(word - 1)));
+   begin = Builder.CreateSelect(deep, begin, top);
+   Builder.CreateCondBr(Builder.CreateICmpULT(begin, top), loop, after);
+
+   Builder.SetInsertPoint(loop);
+   PHINode* address = Builder.CreatePHI(intptr, 2, "paz.address");
+   address->addIncoming(begin, before);
+   Value* stack = Builder.CreateIntToPtr(address, intptr->getPointerTo(), "paz.stack");
+   tagScrub(Builder.CreateStore(ConstantInt::get(intptr, 0), stack, true), stack, "PutAtZero", exit);
+   Value* next = Builder.CreateAdd(address, ConstantInt::get(intptr, word));
+   address->addIncoming(next, loop);
+   Builder.CreateCondBr(Builder.CreateICmpULT(next, top), loop, after);
+
+   Builder.SetInsertPoint(&after->front());
+   Value* outer = Builder.CreateICmpEQ(saved, ConstantInt::get(intptr, 0));
+   Builder.CreateStore(Builder.CreateSelect(outer, ConstantInt::get(intptr, 0), top), lowest);
+}
+
+/**
+ * @function track:
+ * lowers the high-water mark of the thread to the stack pointer of F, it is left as is when no entry point runs (0)
+ * @param F a function below the entry points: no STORE 0 is added to it
+ **/
+void StackLeak::track(Function& F){
+   Instruction* sp = getStackPointer(F);
+   IRBuilder<> Builder(sp->getNextNode());
+   Value* address = Builder.CreatePtrToInt(sp, lowest->getValueType());
+   Value* mark = Builder.CreateLoad(lowest->getValueType(), lowest, "paz.lowest");
+   Value* below = Builder.CreateICmpULT(address, mark);
+   Builder.CreateStore(Builder.CreateSelect(below, address, mark), lowest);
+}
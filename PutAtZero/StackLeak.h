@@ -0,0 +1,35 @@
+#ifndef STACKLEAK_H
+#define STACKLEAK_H
+
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Instructions.h"
+#include <set>
+#include <string>
+#include <vector>
+
+//-paz-stackleak: instead of a STORE 0 per frame, the stack touched below an entry point is wiped at once when it returns
+//entry point -> records its stack pointer on entry (__paz_stack_enter), wipes the range below it before its exits, with a loop run in its own frame
+//below it    -> only lowers the high-water mark of the thread (__paz_stack_lowest) to its stack pointer
+class StackLeak{
+ public:
+   void initialize(llvm::Module& M, const std::vector<std::string>& names, uint64_t slack);
+   bool isEntry(llvm::Function& F) const;
+   bool isTracked(llvm::Function& F) const;
+   unsigned getNumEntries() const;
+   void instrumentEntry(llvm::Function& F);
+   void track(llvm::Function& F);
+
+ private:
+   llvm::GlobalVariable* lowest;//__paz_stack_lowest, thread local
+   llvm::Function* enter;//__paz_stack_enter
+   llvm::Function* stackSave;//llvm.stacksave
+   uint64_t slack;//the bytes wiped below the lowest address recorded
+   std::set<const llvm::Function*> entries;//the functions annotated with paz_entry, the "paz-entry" attribute or named with -paz-entry
+   std::set<const llvm::Function*> below;//the functions only called below the entry points
+
+   void findBelow(llvm::Module& M);
+   llvm::Instruction* getStackPointer(llvm::Function& F);
+   void wipe(llvm::Instruction* exit, llvm::Value* saved, llvm::Value* top);
+};
+
+#endif
@@ -0,0 +1,601 @@
+/**
+ * Runtime of the code instrumented by PutAtZero.
+ *
+ * -paz-count: each thread increments its own counters (no atomic operation, no false sharing) which are summed when they are written.
+ * The counts are written at exit, on SIGUSR1 and before SIGINT/SIGTERM kill the program,
+ * in the file given by the environment variable PAZ_COUNTS_FILE (paz-counts.txt by default).
+ * The handlers only wake a background thread up, which writes them; they are not installed for the signals the program already handles.
+ *
+ * -paz-verify: the first time dead bytes are found at an exit, the variable and the exit are written on stderr;
+ * the number of failed checks is written at exit. With PAZ_VERIFY_ABORT set, the program is aborted at the first one.
+ *
+ * -paz-stackleak: the functions below an entry point lower __paz_stack_lowest to their stack pointer,
+ * the entry point records its own stack pointer with __paz_stack_enter and wipes the stack from there to its frame when it returns
+ * (the wipe is inlined by the pass).
+ *
+ * -paz-switchable: the functions cloned by the pass test __paz_scrub_enabled at their entry. It is cleared before main
+ * when the environment variable PAZ_SCRUB is 0, and can be changed at any time with __paz_set_scrubbing.
+ *
+ * -paz-quarantine: the calls to free go to __paz_free, which sets the buffer to 0 before freeing it.
+ * The buffers smaller than PAZ_QUARANTINE_THRESHOLD (256K by default) are set to 0 by the caller. The larger ones are put in a quarantine
+ * and set to 0 then freed by a background thread; the buffers from PAZ_QUARANTINE_SPLIT (8M) on are split in chunks of 1M
+ * shared by a pool of PAZ_QUARANTINE_THREADS threads (2). The quarantine never holds more than PAZ_QUARANTINE_LIMIT bytes (64M):
+ * once full, the caller sets its buffer to 0 itself. __paz_quarantine_flush waits until the quarantine is empty, it is called at exit.
+ * With PAZ_QUARANTINE_STATS set, the counters of __paz_quarantine_stats are written on stderr at exit.
+ *
+ * Sensitive global variables: the pass puts them in the section paz_sensitive, set to 0 at once by the destructor it adds
+ * or whenever the program calls __paz_wipe_sensitive_globals.
+ * @author INRIA Bordeaux STORM Project Team
+ **/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __APPLE__
+#include <malloc/malloc.h>
+#define malloc_usable_size malloc_size
+#else
+#include <malloc.h>
+#endif
+#include "PaZRuntime.h"
+
+struct paz_thread_counters{
+   struct paz_sites* module;
+   uint64_t* counts;
+   struct paz_thread_counters* next_module;//the counters of the same thread for the other modules
+   struct paz_thread_counters* next;//all the counters
+};
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static struct paz_sites* modules = NULL;
+static struct paz_thread_counters* all_counters = NULL;
+static __thread struct paz_thread_counters* thread_counters = NULL;
+
+static int dump_pipe[2] = {-1, -1};//the signals received, from the handler to the thread writing the counts
+
+static void write_counters(void);
+
+//only write is async-signal-safe: the counts are written by dump_worker
+static void dump_on_signal(int sig){
+   int saved = errno;
+   unsigned char received = (unsigned char)sig;
+   if(write(dump_pipe[1], &received, 1) != 1){//the pipe is full: the counts are about to be written anyway
+   }
+   errno = saved;
+}
+
+static void* dump_worker(void* unused){
+   (void)unused;
+   for(;;){
+      unsigned char sig;
+      ssize_t n = read(dump_pipe[0], &sig, 1);
+      if(n < 0 && errno == EINTR){
+	 continue;
+      }
+      if(n != 1){
+	 return NULL;
+      }
+      write_counters();
+      if(sig != SIGUSR1){//the program was killed: it goes on with the default behavior
+	 signal(sig, SIG_DFL);
+	 raise(sig);
+      }
+   }
+}
+
+/**
+ * @function start_dump_worker:
+ * opens the pipe of the signal handlers and starts the thread reading it
+ * @returns 0 if it failed: the counts are only written at exit
+ **/
+static int start_dump_worker(void){
+   if(pipe(dump_pipe) != 0){
+      return 0;
+   }
+   fcntl(dump_pipe[0], F_SETFD, FD_CLOEXEC);
+   fcntl(dump_pipe[1], F_SETFD, FD_CLOEXEC);
+   pthread_t thread;
+   if(pthread_create(&thread, NULL, dump_worker, NULL) != 0){
+      close(dump_pipe[0]);
+      close(dump_pipe[1]);
+      dump_pipe[0] = dump_pipe[1] = -1;
+      return 0;
+   }
+   pthread_detach(thread);
+   return 1;
+}
+
+//the thread is not copied by fork, and the pipe is shared with the parent: the child gets its own
+static void restart_dump_worker(void){
+   if(dump_pipe[0] >= 0){
+      close(dump_pipe[0]);
+      close(dump_pipe[1]);
+      start_dump_worker();
+   }
+}
+
+//the handlers of the program, or the ones set by its libraries before, are left as they are
+static void dump_on(int sig){
+   struct sigaction old;
+   if(sigaction(sig, NULL, &old) != 0 || (old.sa_flags & SA_SIGINFO) || old.sa_handler != SIG_DFL){
+      return;
+   }
+   struct sigaction action;
+   memset(&action, 0, sizeof(action));
+   action.sa_handler = dump_on_signal;
+   action.sa_flags = SA_RESTART;
+   sigemptyset(&action.sa_mask);
+   sigaction(sig, &action, NULL);
+}
+
+/**
+ * @function __paz_register_sites:
+ * called by the constructor of each instrumented module
+ * @param module the STORE 0 of the module
+ **/
+void __paz_register_sites(struct paz_sites* module){
+   pthread_mutex_lock(&lock);
+   if(modules == NULL){
+      atexit(__paz_dump_counters);
+      if(start_dump_worker()){
+	 pthread_atfork(NULL, NULL, restart_dump_worker);
+	 dump_on(SIGUSR1);
+	 dump_on(SIGINT);
+	 dump_on(SIGTERM);
+      }
+   }
+   module->next = modules;
+   modules = module;
+   pthread_mutex_unlock(&lock);
+}
+
+/**
+ * @function __paz_thread_counters:
+ * called at the entry of the instrumented functions
+ * @param module the STORE 0 of the module of the function
+ * @returns the counters of the current thread for this module
+ **/
+uint64_t* __paz_thread_counters(struct paz_sites* module){
+   struct paz_thread_counters* counters = thread_counters;
+   while(counters != NULL && counters->module != module){
+      counters = counters->next_module;
+   }
+   if(counters != NULL){
+      return counters->counts;
+   }
+   counters = malloc(sizeof(struct paz_thread_counters));
+   counters->module = module;
+   counters->counts = calloc(module->count ? module->count : 1, sizeof(uint64_t));
+   counters->next_module = thread_counters;
+   thread_counters = counters;
+   //kept once the thread is over so that its counts are still written
+   pthread_mutex_lock(&lock);
+   counters->next = all_counters;
+   all_counters = counters;
+   pthread_mutex_unlock(&lock);
+   return counters->counts;
+}
+
+/**
+ * @function write_counters:
+ * sums the counters of all the threads and writes them, one line per STORE 0
+ **/
+static void write_counters(void){
+   pthread_mutex_lock(&lock);
+   const char* path = getenv("PAZ_COUNTS_FILE");
+   FILE* out = fopen(path != NULL ? path : "paz-counts.txt", "w");
+   if(out != NULL){
+      for(struct paz_sites* module = modules; module != NULL; module = module->next){
+	 for(uint32_t i = 0; i < module->count; ++i){
+	    uint64_t total = 0;
+	    for(struct paz_thread_counters* counters = all_counters; counters != NULL; counters = counters->next){
+	       if(counters->module == module){
+		  total += counters->counts[i];
+	       }
+	    }
+	    const struct paz_site* site = &module->sites[i];
+	    fprintf(out, "%s:%u:%u\t%s\t%s\t%llu\n", site->file, site->line, site->column, site->function, module->module, (unsigned long long)total);
+	 }
+      }
+      fclose(out);
+   }
+   pthread_mutex_unlock(&lock);
+}
+
+/**
+ * @function __paz_dump_counters:
+ * writes the counts now, registered with atexit
+ **/
+void __paz_dump_counters(void){
+   write_counters();
+}
+
+static uint64_t verify_failures = 0;
+
+static void report_verify_failures(void){
+   fprintf(stderr, "paz-verify: %llu checks found dead bytes not set to 0\n", (unsigned long long)verify_failures);
+}
+
+/**
+ * @function __paz_verify_slot:
+ * called before an exit of a function: the bytes of the variable still live (written and not set to 0 since) are dead and should be 0
+ * @param site the variable and the exit
+ * @param slot the variable
+ * @param shadow the state of each of its bytes
+ * @param size its number of bytes
+ **/
+void __paz_verify_slot(struct paz_verify_site* site, const unsigned char* slot, const unsigned char* shadow, uint64_t size){
+   uint64_t dead = 0;
+   uint64_t first = 0;
+   for(uint64_t i = 0; i < size; ++i){
+      if(shadow[i] == PAZ_LIVE && slot[i] != 0){
+	 if(dead == 0){
+	    first = i;
+	 }
+	 dead++;
+      }
+   }
+   if(dead == 0){
+      return;
+   }
+   if(__atomic_fetch_add(&verify_failures, 1, __ATOMIC_RELAXED) == 0){
+      atexit(report_verify_failures);
+   }
+   if(__atomic_fetch_add(&site->reports, 1, __ATOMIC_RELAXED) == 0){
+      fprintf(stderr, "paz-verify: %llu dead bytes of %s (from byte %llu) not set to 0 when leaving %s (%s:%u)\n",
+	    (unsigned long long)dead, site->variable, (unsigned long long)first, site->function, site->file, site->line);
+   }
+   if(getenv("PAZ_VERIFY_ABORT") != NULL){
+      abort();
+   }
+}
+
+//the lowest stack address reached below the entry point running on the thread, 0 when there is none
+__thread uintptr_t __paz_stack_lowest = 0;
+
+/**
+ * @function __paz_stack_enter:
+ * called at the entry of an entry point
+ * @param top its stack pointer once its frame is allocated
+ * @returns the high-water mark of the entry point running above it, given back when this one returns
+ **/
+uintptr_t __paz_stack_enter(void* top){
+   uintptr_t saved = __paz_stack_lowest;
+   if(saved == 0 || (uintptr_t)top < saved){
+      __paz_stack_lowest = (uintptr_t)top;
+   }
+   return saved;
+}
+
+int32_t __paz_scrub_enabled = 1;
+
+static __attribute__((constructor)) void read_scrub_switch(void){
+   const char* scrub = getenv("PAZ_SCRUB");
+   if(scrub != NULL && strcmp(scrub, "0") == 0){
+      __paz_scrub_enabled = 0;
+   }
+}
+
+/**
+ * @function __paz_set_scrubbing:
+ * chooses the version the switchable functions run from their next call on
+ * @param enabled not 0: the scrubbed version, 0: the plain version
+ **/
+void __paz_set_scrubbing(int enabled){
+   __atomic_store_n(&__paz_scrub_enabled, enabled != 0, __ATOMIC_RELAXED);
+}
+
+#define PAZ_QUARANTINE_JOBS 1024//the chunks waiting to be set to 0
+#define PAZ_QUARANTINE_CHUNK ((size_t)1 << 20)
+#define PAZ_QUARANTINE_MAX_THREADS 16
+
+struct paz_quarantined{//written at the beginning of the buffer itself: the quarantine does not allocate memory
+   size_t size;
+   uint32_t chunks;//the chunks not set to 0 yet
+   uint64_t since;//when the program freed it
+};
+
+struct paz_wipe_job{//the bytes [begin, end) of a buffer, after its header
+   struct paz_quarantined* buffer;
+   size_t begin;
+   size_t end;
+};
+
+static pthread_mutex_t quarantine_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t quarantine_work = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t quarantine_idle = PTHREAD_COND_INITIALIZER;
+static pthread_once_t quarantine_once = PTHREAD_ONCE_INIT;
+static struct paz_wipe_job quarantine_jobs[PAZ_QUARANTINE_JOBS];//circular
+static unsigned quarantine_head = 0;
+static unsigned quarantine_count = 0;
+static unsigned quarantine_threads = 0;//started
+static unsigned quarantine_wiping = 0;//the jobs being run out of quarantine_lock
+static int quarantine_forking = 0;//no job is started until fork returns
+static struct paz_quarantine_stats quarantine_stats;//the counters of the callers are atomic, the others are protected by quarantine_lock
+static size_t quarantine_threshold = (size_t)256 << 10;
+static size_t quarantine_split = (size_t)8 << 20;
+static size_t quarantine_limit = (size_t)64 << 20;
+static unsigned quarantine_max_threads = 2;
+
+static uint64_t now_nanoseconds(void){
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void wipe(void* ptr, size_t size){
+   memset(ptr, 0, size);
+   __asm__ __volatile__("" : : "r"(ptr) : "memory");//the memset is not removed even though the memory is freed right after
+}
+
+static void atomic_max(uint64_t* max, uint64_t value){
+   uint64_t current = __atomic_load_n(max, __ATOMIC_RELAXED);
+   while(value > current && !__atomic_compare_exchange_n(max, &current, value, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+/**
+ * @function read_size:
+ * @param name an environment variable, a number of bytes with an optional K, M or G suffix
+ * @param value its default value
+ * @returns the size it gives
+ **/
+static size_t read_size(const char* name, size_t value){
+   const char* text = getenv(name);
+   if(text == NULL){
+      return value;
+   }
+   char* end;
+   unsigned long long size = strtoull(text, &end, 10);
+   if(end == text){
+      return value;
+   }
+   switch(*end){
+      case 'G': case 'g': size <<= 10;//fall through
+      case 'M': case 'm': size <<= 10;//fall through
+      case 'K': case 'k': size <<= 10;
+   }
+   return (size_t)size;
+}
+
+/**
+ * @function run_job:
+ * sets the next chunk of the quarantine to 0, and frees its buffer if it was the last one
+ * called with quarantine_lock held, which is released during the wipe
+ **/
+static void run_job(void){
+   struct paz_wipe_job job = quarantine_jobs[quarantine_head];
+   quarantine_head = (quarantine_head + 1) % PAZ_QUARANTINE_JOBS;
+   quarantine_count--;
+   quarantine_wiping++;
+   pthread_mutex_unlock(&quarantine_lock);
+   uint64_t begin = now_nanoseconds();
+   wipe((char*)job.buffer + job.begin, job.end - job.begin);
+   uint64_t end = now_nanoseconds();
+   pthread_mutex_lock(&quarantine_lock);
+   quarantine_stats.wipe_nanoseconds += end - begin;
+   if(--job.buffer->chunks == 0){
+      size_t size = job.buffer->size;
+      uint64_t delay = end - job.buffer->since;
+      pthread_mutex_unlock(&quarantine_lock);
+      wipe(job.buffer, sizeof(struct paz_quarantined));
+      free(job.buffer);
+      pthread_mutex_lock(&quarantine_lock);
+      if(delay > quarantine_stats.max_delay_nanoseconds){
+	 quarantine_stats.max_delay_nanoseconds = delay;
+      }
+      quarantine_stats.pending_bytes -= size;
+   }
+   quarantine_wiping--;
+   if(quarantine_stats.pending_bytes == 0 || (quarantine_forking && quarantine_wiping == 0)){
+      pthread_cond_broadcast(&quarantine_idle);
+   }
+}
+
+static void* quarantine_worker(void* unused){
+   (void)unused;
+   pthread_mutex_lock(&quarantine_lock);
+   for(;;){
+      while(quarantine_count == 0 || quarantine_forking){
+	 pthread_cond_wait(&quarantine_work, &quarantine_lock);
+      }
+      run_job();
+   }
+   return NULL;
+}
+
+static void report_quarantine(void){
+   __paz_quarantine_flush();
+   if(getenv("PAZ_QUARANTINE_STATS") == NULL){
+      return;
+   }
+   struct paz_quarantine_stats stats;
+   __paz_quarantine_stats(&stats);
+   uint64_t frees = stats.inline_frees + stats.quarantined_frees;
+   fprintf(stderr, "paz-quarantine: %llu frees (%llu ns on average, %llu ns for the longest), %llu set to 0 inline (%llu bytes, %llu because the quarantine was full)\n",
+	 (unsigned long long)frees, (unsigned long long)(frees ? stats.free_nanoseconds / frees : 0), (unsigned long long)stats.max_free_nanoseconds,
+	 (unsigned long long)stats.inline_frees, (unsigned long long)stats.inline_bytes, (unsigned long long)stats.overflows);
+   fprintf(stderr, "paz-quarantine: %llu quarantined (%llu bytes, %.1f MB/s, at most %llu bytes at once, %llu ns for the longest stay)\n",
+	 (unsigned long long)stats.quarantined_frees, (unsigned long long)stats.quarantined_bytes,
+	 stats.wipe_nanoseconds ? stats.quarantined_bytes * 1e3 / stats.wipe_nanoseconds : 0.0,
+	 (unsigned long long)stats.peak_pending_bytes, (unsigned long long)stats.max_delay_nanoseconds);
+}
+
+//before fork: the wipes already started are finished, so that every buffer of the quarantine is either freed or still in the jobs
+static void lock_quarantine(void){
+   pthread_mutex_lock(&quarantine_lock);
+   quarantine_forking = 1;
+   while(quarantine_wiping > 0){
+      pthread_cond_wait(&quarantine_idle, &quarantine_lock);
+   }
+}
+
+static void unlock_quarantine(void){
+   quarantine_forking = 0;
+   pthread_cond_broadcast(&quarantine_work);
+   pthread_mutex_unlock(&quarantine_lock);
+}
+
+//the threads are not copied by fork: the child sets its copies of the buffers of the quarantine to 0 and frees them at once, then starts its own threads
+static void reset_quarantine(void){
+   quarantine_forking = 0;
+   quarantine_threads = 0;
+   while(quarantine_count > 0){
+      run_job();
+   }
+   pthread_mutex_unlock(&quarantine_lock);
+}
+
+/**
+ * @function read_quarantine_settings:
+ * reads the environment variables PAZ_QUARANTINE_*, at the first call to __paz_free
+ **/
+static void read_quarantine_settings(void){
+   quarantine_threshold = read_size("PAZ_QUARANTINE_THRESHOLD", quarantine_threshold);
+   if(quarantine_threshold < sizeof(struct paz_quarantined) + 1){//the header of a smaller buffer would not leave anything to wipe
+      quarantine_threshold = sizeof(struct paz_quarantined) + 1;
+   }
+   quarantine_split = read_size("PAZ_QUARANTINE_SPLIT", quarantine_split);
+   quarantine_limit = read_size("PAZ_QUARANTINE_LIMIT", quarantine_limit);
+   size_t threads = read_size("PAZ_QUARANTINE_THREADS", quarantine_max_threads);
+   quarantine_max_threads = threads < 1 ? 1 : threads > PAZ_QUARANTINE_MAX_THREADS ? PAZ_QUARANTINE_MAX_THREADS : (unsigned)threads;
+   atexit(report_quarantine);
+   pthread_atfork(lock_quarantine, unlock_quarantine, reset_quarantine);
+}
+
+/**
+ * @function start_workers:
+ * called with quarantine_lock held
+ * @param wanted the number of threads needed: one, or the whole pool for a very large buffer
+ * @returns 0 if no thread could be started
+ **/
+static int start_workers(unsigned wanted){
+   while(quarantine_threads < wanted){
+      pthread_t thread;
+      if(pthread_create(&thread, NULL, quarantine_worker, NULL) != 0){
+	 break;
+      }
+      pthread_detach(thread);
+      quarantine_threads++;
+   }
+   return quarantine_threads > 0;
+}
+
+/**
+ * @function quarantine:
+ * hands a large buffer over to the background threads
+ * @param ptr the buffer
+ * @param size its usable size
+ * @param since when the program freed it
+ * @returns 0 if the quarantine is full: the caller sets the buffer to 0 itself
+ **/
+static int quarantine(void* ptr, size_t size, uint64_t since){
+   size_t chunk = size >= quarantine_split ? PAZ_QUARANTINE_CHUNK : size;
+   size_t chunks = (size - sizeof(struct paz_quarantined) + chunk - 1) / chunk;
+   pthread_mutex_lock(&quarantine_lock);
+   if(quarantine_stats.pending_bytes + size > quarantine_limit || quarantine_count + chunks > PAZ_QUARANTINE_JOBS
+	 || !start_workers(size >= quarantine_split ? quarantine_max_threads : 1)){
+      quarantine_stats.overflows++;
+      pthread_mutex_unlock(&quarantine_lock);
+      return 0;
+   }
+   struct paz_quarantined* buffer = ptr;
+   buffer->size = size;
+   buffer->chunks = (uint32_t)chunks;
+   buffer->since = since;
+   for(size_t begin = sizeof(struct paz_quarantined); begin < size; begin += chunk){
+      struct paz_wipe_job* job = &quarantine_jobs[(quarantine_head + quarantine_count++) % PAZ_QUARANTINE_JOBS];
+      job->buffer = buffer;
+      job->begin = begin;
+      job->end = size - begin > chunk ? begin + chunk : size;
+   }
+   quarantine_stats.quarantined_frees++;
+   quarantine_stats.quarantined_bytes += size;
+   quarantine_stats.pending_bytes += size;
+   if(quarantine_stats.pending_bytes > quarantine_stats.peak_pending_bytes){
+      quarantine_stats.peak_pending_bytes = quarantine_stats.pending_bytes;
+   }
+   if(chunks > 1){
+      pthread_cond_broadcast(&quarantine_work);
+   }
+   else{
+      pthread_cond_signal(&quarantine_work);
+   }
+   pthread_mutex_unlock(&quarantine_lock);
+   return 1;
+}
+
+/**
+ * @function __paz_free:
+ * replaces free in the instrumented code: sets the buffer to 0 before freeing it, at once or in the background
+ * @param ptr a buffer given by malloc, calloc, realloc... or NULL
+ **/
+void __paz_free(void* ptr){
+   if(ptr == NULL){
+      return;
+   }
+   uint64_t begin = now_nanoseconds();
+   pthread_once(&quarantine_once, read_quarantine_settings);
+   size_t size = malloc_usable_size(ptr);
+   if(size < quarantine_threshold || !quarantine(ptr, size, begin)){
+      wipe(ptr, size);
+      free(ptr);
+      __atomic_fetch_add(&quarantine_stats.inline_frees, 1, __ATOMIC_RELAXED);
+      __atomic_fetch_add(&quarantine_stats.inline_bytes, size, __ATOMIC_RELAXED);
+   }
+   uint64_t spent = now_nanoseconds() - begin;
+   __atomic_fetch_add(&quarantine_stats.free_nanoseconds, spent, __ATOMIC_RELAXED);
+   atomic_max(&quarantine_stats.max_free_nanoseconds, spent);
+}
+
+/**
+ * @function __paz_quarantine_flush:
+ * returns once all the buffers of the quarantine are set to 0 and freed, the caller helps the background threads
+ **/
+void __paz_quarantine_flush(void){
+   pthread_mutex_lock(&quarantine_lock);
+   while(quarantine_count > 0 && !quarantine_forking){
+      run_job();
+   }
+   while(quarantine_stats.pending_bytes > 0){//the chunks the background threads are setting to 0
+      pthread_cond_wait(&quarantine_idle, &quarantine_lock);
+   }
+   pthread_mutex_unlock(&quarantine_lock);
+}
+
+/**
+ * @function __paz_quarantine_stats:
+ * @param stats set to the counters of the quarantine since the program started
+ **/
+void __paz_quarantine_stats(struct paz_quarantine_stats* stats){
+   pthread_mutex_lock(&quarantine_lock);
+   *stats = quarantine_stats;
+   stats->inline_frees = __atomic_load_n(&quarantine_stats.inline_frees, __ATOMIC_RELAXED);
+   stats->inline_bytes = __atomic_load_n(&quarantine_stats.inline_bytes, __ATOMIC_RELAXED);
+   stats->free_nanoseconds = __atomic_load_n(&quarantine_stats.free_nanoseconds, __ATOMIC_RELAXED);
+   stats->max_free_nanoseconds = __atomic_load_n(&quarantine_stats.max_free_nanoseconds, __ATOMIC_RELAXED);
+   pthread_mutex_unlock(&quarantine_lock);
+}
+
+//defined by the linker when at least one variable is in the section
+extern char __start_paz_sensitive[] __attribute__((weak));
+extern char __stop_paz_sensitive[] __attribute__((weak));
+
+/**
+ * @function __paz_wipe_sensitive_globals:
+ * sets all the sensitive global variables of the program to 0
+ **/
+void __paz_wipe_sensitive_globals(void){
+   char* start = __start_paz_sensitive;
+   char* stop = __stop_paz_sensitive;
+   if(start == NULL || stop <= start){
+      return;
+   }
+   memset(start, 0, stop - start);
+   __asm__ __volatile__("" : : "r"(start) : "memory");//the memset is not removed even though the memory is not read again
+}
@@ -0,0 +1,85 @@
+#ifndef PAZRUNTIME_H
+#define PAZRUNTIME_H
+
+/**
+ * Runtime support of the code instrumented by PutAtZero.
+ * The structures below are built by the pass (ScrubCounters.cpp, ScrubVerifier.cpp): their layout must stay the same on both sides.
+ * @author INRIA Bordeaux STORM Project Team
+ **/
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct paz_site{//a STORE 0 added by the pass
+   const char* file;
+   const char* function;
+   uint32_t line;
+   uint32_t column;
+};
+
+struct paz_sites{//the STORE 0 of a module, one per module
+   const char* module;
+   const struct paz_site* sites;
+   uint32_t count;
+   struct paz_sites* next;//set by the runtime
+};
+
+enum paz_shadow_state{//the shadow of each byte of a variable, -paz-verify
+   PAZ_UNKNOWN = 0,//not written by the function
+   PAZ_LIVE = 1,//written since the last STORE 0: dead but not set to 0 if it is still live when the function exits
+   PAZ_SCRUBBED = 2//set to 0 by a STORE 0
+};
+
+struct paz_verify_site{//a variable checked at an exit of a function
+   const char* function;
+   const char* variable;
+   const char* file;
+   uint32_t line;
+   uint32_t reports;//the number of times dead bytes were found, set by the runtime
+};
+
+//-paz-count
+void __paz_register_sites(struct paz_sites* module);
+uint64_t* __paz_thread_counters(struct paz_sites* module);
+void __paz_dump_counters(void);
+
+//-paz-verify
+void __paz_verify_slot(struct paz_verify_site* site, const unsigned char* slot, const unsigned char* shadow, uint64_t size);
+
+//-paz-stackleak
+extern __thread uintptr_t __paz_stack_lowest;
+uintptr_t __paz_stack_enter(void* top);
+
+//-paz-switchable: the switchable functions run their scrubbed version when set (default), their plain version otherwise
+extern int32_t __paz_scrub_enabled;
+void __paz_set_scrubbing(int enabled);
+
+//-paz-quarantine: the calls to free of the program
+struct paz_quarantine_stats{
+   uint64_t inline_frees;//wiped by the caller before being freed: small buffers, quarantine full
+   uint64_t inline_bytes;
+   uint64_t overflows;//large buffers wiped by the caller because the quarantine was full
+   uint64_t quarantined_frees;//large buffers wiped by the background threads
+   uint64_t quarantined_bytes;
+   uint64_t pending_bytes;//in the quarantine now
+   uint64_t peak_pending_bytes;
+   uint64_t free_nanoseconds;//time spent in __paz_free by the program
+   uint64_t max_free_nanoseconds;//longest call
+   uint64_t wipe_nanoseconds;//time spent wiping by the background threads
+   uint64_t max_delay_nanoseconds;//longest stay of a buffer in the quarantine
+};
+void __paz_free(void* ptr);
+void __paz_quarantine_flush(void);
+void __paz_quarantine_stats(struct paz_quarantine_stats* stats);
+
+//sensitive global variables (section paz_sensitive)
+void __paz_wipe_sensitive_globals(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
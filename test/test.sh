@@ -1,18 +1,40 @@
 #!/bin/bash
 place=`pwd`/src-test-files
-COLS=$(tput cols)
+COLS=$(tput cols 2>/dev/null || echo 80)
+#the passes built by cmake, PAZ_BUILD=<build directory> to test another build
+build=${PAZ_BUILD:-~/storm/llvm-joujou/test/storm_project/build}
+#the legacy pass manager runs the passes loaded with -load, it has to be asked for since LLVM 13
+legacy=""
+if (( `opt --version | grep -o -m 1 "version [0-9]*" | cut -d" " -f2` >= 13 ))
+then
+   legacy="-enable-new-pm=0"
+fi
 cd $place
 function binGenerator {
    echo $1
-   clang -emit-llvm -c -o $1.bc $1.c
+   if [[ -e $1.ir ]]
+   then
+      llvm-as -o $1.bc $1.ir
+   else
+      clang -emit-llvm -c -o $1.bc $1.c
+   fi
    if [[ "$3" == "I" ]]
    then
-      opt -load ~/storm/llvm-joujou/test/storm_project/build/Initialize/LLVMInitialize.so -Initialize < $1.bc > $2.bc
+      opt $legacy -load $build/Initialize/LLVMInitialize.so -Initialize < $1.bc > $2.bc
    fi
    if [[ "$3" == "D" ]]
    then
+      options=""
+      if [[ -e $1.opts ]]
+      then
+	 options=`cat $1.opts`
+      fi
       opt -dse < $1.bc > temp.bc
-      opt -load ~/storm/llvm-joujou/test/storm_project/build/PutAtZero/LLVMPutAtZero.so -PaZ < temp.bc > $2.bc
+      #what the pass prints is compared too when the expected results have a .err (-paz-estimate report...)
+      opt $legacy -load $build/PutAtZero/LLVMPutAtZero.so -PaZ $options -paz-plan-export=$1.plan < temp.bc > $2.bc 2> $1.err
+      cat $1.err >&2
+      #the plan exported must give the same code when it is replayed
+      opt $legacy -load $build/PutAtZero/LLVMPutAtZero.so -PaZ $options -paz-plan-import=$1.plan -paz-plan-export=$1.replay < temp.bc > replay.bc
    fi
    llvm-dis -o $1.ll $2.bc
    llc $2.bc
@@ -22,6 +44,11 @@ function binGenerator {
       return
    fi
    cat $1.ll | grep -v "ModuleID" > $1.txt
+   #the order of the uses written in the bitcode may differ, the code is compared
+   if [[ "$3" == "D" ]] && ! (cmp -s <(llvm-dis < $2.bc) <(llvm-dis < replay.bc) && cmp -s $1.plan $1.replay)
+   then
+      echo "the plan exported is not replayed" >> $1.txt
+   fi
 }
 
 function binChecker {
@@ -45,6 +72,14 @@ function binChecker {
       return
    fi
   DIFF=$(diff $1.txt ../../expected-results-tst/$dir/$1.txt)
+   if [[ -e ../../expected-results-tst/$dir/$1.plan ]]
+   then
+      DIFF=$DIFF$(diff $1.plan ../../expected-results-tst/$dir/$1.plan)
+   fi
+   if [[ -e ../../expected-results-tst/$dir/$1.err ]]
+   then
+      DIFF=$DIFF$(diff $1.err ../../expected-results-tst/$dir/$1.err)
+   fi
    if [[ $DIFF != "" ]]
    then
       echo 1
@@ -62,7 +97,7 @@ function fatalTestor {
    let "i=1"
    for file in $(ls)
    do
-      if [ ${file: -2} == ".c" ]
+      if [[ ${file: -3} == ".ir" || ( ${file: -2} == ".c" && ! -e ${file%.c}.ir ) ]]
       then
 	 my_file=`echo "$file" | cut -d\. -f1`
 	 binGenerator $my_file $i $1
@@ -76,7 +111,7 @@ function fatalDisplayer {
    let "i=1"
    for file in $(ls)
    do
-      if [ ${file: -2} == ".c" ]
+      if [[ ${file: -3} == ".ir" || ( ${file: -2} == ".c" && ! -e ${file%.c}.ir ) ]]
       then
    	 echo -n -e "\n$file"
    	 my_file=`echo "$file" | cut -d\. -f1` 
@@ -112,19 +147,28 @@ function fatalDisplayer {
       echo -ne "\033[0;91m"
    fi
    echo -e "$(( successRate / 100)).$(( successRate % 100))%\n\n\n\033[0m"
-   rm -f *.bc my_bc *.ll *.s
+   rm -f *.bc my_bc *.ll *.s *.plan *.replay *.err
    echo $j > value.txt
 }
 
+#a test is a .c or a .ir file, the .ir when both exist
+function countTests {
+   ls | grep -E "\.(c|ir)$" | sed -E "s/\.(c|ir)$//" | sort -u | wc -l
+}
+
 function ultimateCleaner {
-   rm -f $1/*.ll $1/*.bc #$1/.txt
+   rm -f $1/*.ll $1/*.bc $1/*.plan $1/*.replay $1/*.err #$1/.txt
 }
 
 clear
 echo "Do not worry if you see useless stuff for testing purposes, the execution is written over cerrs and as far as my knowledge goes, i don't know a way to hide it while saving it"
 echo "for convention, everything will be erased before showing test results"
 printf "\n\n\n\n\n%*s\n\n\n\n\n" $[$COLS/2] "press I for Initialization tests and D for DeadVariables tests"
-read continuation
+continuation=$1
+if [[ "$continuation" == "" ]]
+then
+   read continuation
+fi
 while [[ "$continuation" != "I" && "$continuation" != "D" ]]
 do
    echo "please press I for Initialization or D for DeadVariables tests"
@@ -138,21 +182,35 @@ fatalTestor $continuation
 wd=`pwd`
 a=`cat $wd/value.txt`
 let "success+=a"
-nfiles=`ls | grep -c -o "\.c"`
+nfiles=`countTests`
 let "total+=nfiles"
 cd ../c_array_tests
 fatalTestor $continuation
 wd=`pwd`
 a=`cat $wd/value.txt`
 let "success+=a"
-nfiles=`ls | grep -c -o "\.c"`
+nfiles=`countTests`
 let "total+=nfiles"
 cd ../c_cond_tests
 fatalTestor $continuation
 wd=`pwd`
 a=`cat $wd/value.txt`
 let "success+=a"
-nfiles=`ls | grep -c -o "\.c"`
+nfiles=`countTests`
+let "total+=nfiles"
+cd ../ir_exception_tests
+fatalTestor $continuation
+wd=`pwd`
+a=`cat $wd/value.txt`
+let "success+=a"
+nfiles=`countTests`
+let "total+=nfiles"
+cd ../option_tests
+fatalTestor $continuation
+wd=`pwd`
+a=`cat $wd/value.txt`
+let "success+=a"
+nfiles=`countTests`
 let "total+=nfiles"
 clear
 printf "\t\t%*s\n\n" $[$COLS/2] "Testing basic C functions without condition or loop or array"
@@ -167,6 +225,14 @@ cd ../c_cond_tests
 printf "\n\t\t%*s\n\n" $[COLS/2] " Testing simple and more complex conditions and loops"
 fatalDisplayer $continuation
 ultimateCleaner .
+cd ../ir_exception_tests
+printf "\n\t\t%*s\n\n" $[COLS/2] " Testing the landing pads and the resume exits (textual IR)"
+fatalDisplayer $continuation
+ultimateCleaner .
+cd ../option_tests
+printf "\n\t\t%*s\n\n" $[COLS/2] " Testing the options of the pass: edges, tiers, verification build, plans (textual IR)"
+fatalDisplayer $continuation
+ultimateCleaner .
 echo -e "total test: $total\ntotal success: $success"
 percent=$(( success * 100 / total ))
 echo -e "Total success rate: $percent.$(( success * 10000 % total ))%"